@@ -0,0 +1,565 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "document.h"
+#include "page-text.h"
+#include "render.h"
+
+/* meson reports benchmarks that exit with this code as skipped */
+#define BENCH_SKIP 77
+#define BENCH_PAGES 20
+#define BENCH_RUNS 5
+#define BENCH_OPEN_RUNS 10
+#define BENCH_PAGE_WIDTH 2552
+#define BENCH_PAGE_HEIGHT 3300
+#define BENCH_DPI 300
+#define BENCH_MARGIN 150
+#define BENCH_WORDS_PER_LINE 12
+#define BENCH_WORD_WIDTH 180
+#define BENCH_LINE_HEIGHT 50
+#define BENCH_QUERY "lorem"
+
+/**
+ * Timings of one operation
+ */
+typedef struct bench_operation_s {
+  char* name;      /**< Name of the operation */
+  GArray* samples; /**< Durations in microseconds */
+} bench_operation_t;
+
+static const double render_scales[] = {0.5, 1.0, 2.0};
+
+/* forward declarations */
+static int generate_fixture(const char* directory, char** path);
+static bool write_page_image(const char* path);
+static bool write_page_text(const char* path);
+static bool write_outline(const char* path);
+static bool run_tool(char** argv);
+static void remove_directory(const char* directory);
+static bench_operation_t* operation_add(GArray* operations, char* name);
+static void operation_add_sample(bench_operation_t* operation, gint64 start);
+static bool bench_open(const char* path, GArray* operations);
+static bool bench_page_init(djvu_document_t* document, djvu_geometry_t* geometries, GArray* operations);
+static bool bench_render(djvu_document_t* document, const djvu_geometry_t* geometries, double scale,
+                         GArray* operations);
+static void bench_search(djvu_document_t* document, GArray* operations);
+static void bench_get_text(djvu_document_t* document, const djvu_geometry_t* geometries, GArray* operations);
+static void bench_index(djvu_document_t* document, GArray* operations);
+static void print_json(const char* path, unsigned int number_of_pages, GArray* operations);
+static void print_json_string(const char* text);
+static gint64 get_percentile(GArray* samples, unsigned int percentile);
+static gint compare_samples(gconstpointer a, gconstpointer b);
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [FILE]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int result      = EXIT_FAILURE;
+  char* directory = NULL;
+  char* path      = NULL;
+
+  /* without a document a synthetic one is built with the djvulibre tools */
+  if (argc == 2) {
+    path = g_strdup(argv[1]);
+  } else {
+    directory = g_dir_make_tmp("zathura-djvu-bench-XXXXXX", NULL);
+    if (directory == NULL) {
+      fprintf(stderr, "could not create a temporary directory\n");
+      goto error_ret;
+    }
+
+    result = generate_fixture(directory, &path);
+    if (result != EXIT_SUCCESS) {
+      goto error_free;
+    }
+
+    result = EXIT_FAILURE;
+  }
+
+  GArray* operations = g_array_new(FALSE, FALSE, sizeof(bench_operation_t));
+  if (bench_open(path, operations) == false) {
+    fprintf(stderr, "%s: could not open document\n", path);
+    goto error_operations;
+  }
+
+  zathura_error_t error     = ZATHURA_ERROR_OK;
+  djvu_document_t* document = djvu_document_new(path, &error);
+  if (document == NULL) {
+    fprintf(stderr, "%s: could not open document\n", path);
+    goto error_operations;
+  }
+
+  const unsigned int number_of_pages = ddjvu_document_get_pagenum(document->document);
+  djvu_geometry_t* geometries        = g_new0(djvu_geometry_t, number_of_pages);
+
+  if (bench_page_init(document, geometries, operations) == false) {
+    fprintf(stderr, "%s: could not read the pages\n", path);
+    goto error_document;
+  }
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS(render_scales); i++) {
+    if (bench_render(document, geometries, render_scales[i], operations) == false) {
+      fprintf(stderr, "%s: could not render the pages\n", path);
+      goto error_document;
+    }
+  }
+
+  bench_search(document, operations);
+  bench_get_text(document, geometries, operations);
+  bench_index(document, operations);
+
+  print_json(path, number_of_pages, operations);
+  result = EXIT_SUCCESS;
+
+error_document:
+
+  g_free(geometries);
+  djvu_document_destroy(document);
+
+error_operations:
+
+  for (guint i = 0; i < operations->len; i++) {
+    bench_operation_t* operation = &g_array_index(operations, bench_operation_t, i);
+    g_free(operation->name);
+    g_array_free(operation->samples, TRUE);
+  }
+  g_array_free(operations, TRUE);
+
+error_free:
+
+  if (directory != NULL) {
+    remove_directory(directory);
+    g_free(directory);
+  }
+  g_free(path);
+
+error_ret:
+
+  return result;
+}
+
+/**
+ * Builds a bundled document of BENCH_PAGES pages with a text layer and an
+ * outline
+ *
+ * @param directory Directory for the document and intermediate files
+ * @param path Receives the path of the document
+ * @return EXIT_SUCCESS, BENCH_SKIP if the tools are missing or EXIT_FAILURE
+ */
+static int generate_fixture(const char* directory, char** path) {
+  const char* tools[] = {"cjb2", "djvused", "djvm"};
+  for (unsigned int i = 0; i < G_N_ELEMENTS(tools); i++) {
+    char* tool = g_find_program_in_path(tools[i]);
+    if (tool == NULL) {
+      fprintf(stderr, "%s not found, skipping\n", tools[i]);
+      return BENCH_SKIP;
+    }
+    g_free(tool);
+  }
+
+  int result         = EXIT_FAILURE;
+  char* image        = g_build_filename(directory, "page.pbm", NULL);
+  char* page         = g_build_filename(directory, "page.djvu", NULL);
+  char* text         = g_build_filename(directory, "text.dsed", NULL);
+  char* outline      = g_build_filename(directory, "outline.dsed", NULL);
+  char* document     = g_build_filename(directory, "document.djvu", NULL);
+  char* page_data    = NULL;
+  gsize page_length  = 0;
+  GPtrArray* command = g_ptr_array_new_with_free_func(g_free);
+
+  if (write_page_image(image) == false || write_page_text(text) == false || write_outline(outline) == false) {
+    goto error_free;
+  }
+
+  char* dpi          = g_strdup_printf("%d", BENCH_DPI);
+  char* encode[]     = {"cjb2", "-dpi", dpi, image, page, NULL};
+  const bool encoded = run_tool(encode);
+  g_free(dpi);
+  if (encoded == false) {
+    goto error_free;
+  }
+
+  char* set_text       = g_strdup_printf("set-txt %s", text);
+  char* annotate[]     = {"djvused", page, "-e", set_text, "-s", NULL};
+  const bool annotated = run_tool(annotate);
+  g_free(set_text);
+  if (annotated == false || g_file_get_contents(page, &page_data, &page_length, NULL) == FALSE) {
+    goto error_free;
+  }
+
+  /* every page is a copy of the same component */
+  g_ptr_array_add(command, g_strdup("djvm"));
+  g_ptr_array_add(command, g_strdup("-c"));
+  g_ptr_array_add(command, g_strdup(document));
+  for (unsigned int i = 0; i < BENCH_PAGES; i++) {
+    char* name      = g_strdup_printf("page-%03u.djvu", i + 1);
+    char* component = g_build_filename(directory, name, NULL);
+    g_free(name);
+
+    if (g_file_set_contents(component, page_data, page_length, NULL) == FALSE) {
+      g_free(component);
+      goto error_free;
+    }
+    g_ptr_array_add(command, component);
+  }
+  g_ptr_array_add(command, NULL);
+
+  if (run_tool((char**)command->pdata) == false) {
+    goto error_free;
+  }
+
+  char* set_outline     = g_strdup_printf("set-outline %s", outline);
+  char* structure[]     = {"djvused", document, "-e", set_outline, "-s", NULL};
+  const bool structured = run_tool(structure);
+  g_free(set_outline);
+  if (structured == false) {
+    goto error_free;
+  }
+
+  *path    = document;
+  document = NULL;
+  result   = EXIT_SUCCESS;
+
+error_free:
+
+  g_ptr_array_unref(command);
+  g_free(page_data);
+  g_free(document);
+  g_free(outline);
+  g_free(text);
+  g_free(page);
+  g_free(image);
+
+  return result;
+}
+
+/* a bitonal page with a black bar for every word of the text layer */
+static bool write_page_image(const char* path) {
+  const unsigned int stride = (BENCH_PAGE_WIDTH + 7) / 8;
+  const unsigned int lines  = (BENCH_PAGE_HEIGHT - 2 * BENCH_MARGIN) / BENCH_LINE_HEIGHT;
+  GString* image            = g_string_new(NULL);
+  g_string_append_printf(image, "P4\n%d %d\n", BENCH_PAGE_WIDTH, BENCH_PAGE_HEIGHT);
+
+  guint8* row = g_malloc(stride);
+  for (unsigned int y = 0; y < BENCH_PAGE_HEIGHT; y++) {
+    memset(row, 0, stride);
+
+    /* the upper half of every line is covered by words */
+    if (y >= BENCH_MARGIN && y < BENCH_MARGIN + lines * BENCH_LINE_HEIGHT &&
+        (y - BENCH_MARGIN) % BENCH_LINE_HEIGHT < BENCH_LINE_HEIGHT / 2) {
+      for (unsigned int x = BENCH_MARGIN; x < BENCH_MARGIN + BENCH_WORDS_PER_LINE * BENCH_WORD_WIDTH; x++) {
+        if ((x - BENCH_MARGIN) % BENCH_WORD_WIDTH < BENCH_WORD_WIDTH * 3 / 4) {
+          row[x / 8] |= 0x80 >> (x % 8);
+        }
+      }
+    }
+
+    g_string_append_len(image, (const char*)row, stride);
+  }
+  g_free(row);
+
+  const bool written = g_file_set_contents(path, image->str, image->len, NULL) == TRUE;
+  g_string_free(image, TRUE);
+
+  return written;
+}
+
+/* the text layer matches the bars of the image, every fifth word is the
+ * search query */
+static bool write_page_text(const char* path) {
+  const unsigned int lines = (BENCH_PAGE_HEIGHT - 2 * BENCH_MARGIN) / BENCH_LINE_HEIGHT;
+  GString* text            = g_string_new(NULL);
+
+  g_string_append_printf(text, "(page 0 0 %d %d", BENCH_PAGE_WIDTH, BENCH_PAGE_HEIGHT);
+  for (unsigned int line = 0; line < lines; line++) {
+    /* text coordinates start at the bottom of the page */
+    const unsigned int y1 = BENCH_PAGE_HEIGHT - BENCH_MARGIN - line * BENCH_LINE_HEIGHT;
+    const unsigned int y0 = y1 - BENCH_LINE_HEIGHT / 2;
+    g_string_append_printf(text, "\n (line %d %u %d %u", BENCH_MARGIN, y0, BENCH_PAGE_WIDTH - BENCH_MARGIN, y1);
+
+    for (unsigned int column = 0; column < BENCH_WORDS_PER_LINE; column++) {
+      const unsigned int word = line * BENCH_WORDS_PER_LINE + column;
+      const unsigned int x0   = BENCH_MARGIN + column * BENCH_WORD_WIDTH;
+      const unsigned int x1   = x0 + BENCH_WORD_WIDTH * 3 / 4;
+      g_string_append_printf(text, " (word %u %u %u %u ", x0, y0, x1, y1);
+
+      if (word % 5 == 0) {
+        g_string_append(text, "\"" BENCH_QUERY "\")");
+      } else {
+        g_string_append_printf(text, "\"word%u\")", word);
+      }
+    }
+
+    g_string_append_c(text, ')');
+  }
+  g_string_append(text, ")\n");
+
+  const bool written = g_file_set_contents(path, text->str, text->len, NULL) == TRUE;
+  g_string_free(text, TRUE);
+
+  return written;
+}
+
+/* a chapter for every page with a few sections each */
+static bool write_outline(const char* path) {
+  GString* outline = g_string_new("(bookmarks");
+  for (unsigned int page = 1; page <= BENCH_PAGES; page++) {
+    g_string_append_printf(outline, "\n (\"Chapter %u\" \"#%u\"", page, page);
+    for (unsigned int section = 1; section <= 4; section++) {
+      g_string_append_printf(outline, " (\"Section %u.%u\" \"#%u\")", page, section, page);
+    }
+    g_string_append_c(outline, ')');
+  }
+  g_string_append(outline, ")\n");
+
+  const bool written = g_file_set_contents(path, outline->str, outline->len, NULL) == TRUE;
+  g_string_free(outline, TRUE);
+
+  return written;
+}
+
+static bool run_tool(char** argv) {
+  int status    = 0;
+  GError* error = NULL;
+  if (g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL, NULL, NULL,
+                   &status, &error) == FALSE) {
+    fprintf(stderr, "%s: %s\n", argv[0], error->message);
+    g_error_free(error);
+    return false;
+  }
+
+  if (WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s failed\n", argv[0]);
+    return false;
+  }
+
+  return true;
+}
+
+static void remove_directory(const char* directory) {
+  GDir* dir = g_dir_open(directory, 0, NULL);
+  if (dir != NULL) {
+    const char* name = NULL;
+    while ((name = g_dir_read_name(dir)) != NULL) {
+      char* path = g_build_filename(directory, name, NULL);
+      g_remove(path);
+      g_free(path);
+    }
+    g_dir_close(dir);
+  }
+
+  g_rmdir(directory);
+}
+
+static bench_operation_t* operation_add(GArray* operations, char* name) {
+  bench_operation_t operation = {
+      .name    = name,
+      .samples = g_array_new(FALSE, FALSE, sizeof(gint64)),
+  };
+  g_array_append_val(operations, operation);
+
+  return &g_array_index(operations, bench_operation_t, operations->len - 1);
+}
+
+static void operation_add_sample(bench_operation_t* operation, gint64 start) {
+  const gint64 duration = g_get_monotonic_time() - start;
+  g_array_append_val(operation->samples, duration);
+}
+
+static bool bench_open(const char* path, GArray* operations) {
+  bench_operation_t* operation = operation_add(operations, g_strdup("open"));
+
+  for (unsigned int run = 0; run < BENCH_OPEN_RUNS; run++) {
+    zathura_error_t error     = ZATHURA_ERROR_OK;
+    const gint64 start        = g_get_monotonic_time();
+    djvu_document_t* document = djvu_document_new(path, &error);
+    operation_add_sample(operation, start);
+
+    if (document == NULL) {
+      return false;
+    }
+
+    djvu_document_destroy(document);
+  }
+
+  return true;
+}
+
+/* the geometry of every page is what djvu_page_init waits for */
+static bool bench_page_init(djvu_document_t* document, djvu_geometry_t* geometries, GArray* operations) {
+  bench_operation_t* operation       = operation_add(operations, g_strdup("page-init"));
+  const unsigned int number_of_pages = ddjvu_document_get_pagenum(document->document);
+
+  for (unsigned int run = 0; run < BENCH_RUNS; run++) {
+    for (unsigned int index = 0; index < number_of_pages; index++) {
+      const gint64 start = g_get_monotonic_time();
+      if (djvu_document_get_geometry(document, index, &geometries[index]) != ZATHURA_ERROR_OK) {
+        return false;
+      }
+      operation_add_sample(operation, start);
+    }
+  }
+
+  return true;
+}
+
+/* renders skip the render cache of the plugin, only decoded pages are kept */
+static bool bench_render(djvu_document_t* document, const djvu_geometry_t* geometries, double scale,
+                         GArray* operations) {
+  bench_operation_t* operation       = operation_add(operations, g_strdup_printf("render-%.1f", scale));
+  const unsigned int number_of_pages = ddjvu_document_get_pagenum(document->document);
+
+  for (unsigned int run = 0; run < BENCH_RUNS; run++) {
+    for (unsigned int index = 0; index < number_of_pages; index++) {
+      const int width  = MAX(1, (int)lround(djvu_geometry_get_width(&geometries[index]) * scale));
+      const int height = MAX(1, (int)lround(djvu_geometry_get_height(&geometries[index]) * scale));
+
+      cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+      if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(surface);
+        return false;
+      }
+
+      const gint64 start  = g_get_monotonic_time();
+      const bool rendered = djvu_render_page(document, index, surface, NULL, NULL) == ZATHURA_ERROR_OK;
+      operation_add_sample(operation, start);
+      cairo_surface_destroy(surface);
+
+      if (rendered == false) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* text layers come from the text cache after the first run, as in the plugin */
+static void bench_search(djvu_document_t* document, GArray* operations) {
+  bench_operation_t* operation       = operation_add(operations, g_strdup("search"));
+  const unsigned int number_of_pages = ddjvu_document_get_pagenum(document->document);
+
+  for (unsigned int run = 0; run < BENCH_RUNS; run++) {
+    for (unsigned int index = 0; index < number_of_pages; index++) {
+      const gint64 start          = g_get_monotonic_time();
+      djvu_page_text_t* page_text = djvu_page_text_take(document, index);
+      if (page_text != NULL) {
+        girara_list_t* results = djvu_page_text_search(page_text, BENCH_QUERY);
+        if (results != NULL) {
+          girara_list_free(results);
+        }
+        djvu_page_text_return(document, page_text);
+      }
+      operation_add_sample(operation, start);
+    }
+  }
+}
+
+static void bench_get_text(djvu_document_t* document, const djvu_geometry_t* geometries, GArray* operations) {
+  bench_operation_t* operation       = operation_add(operations, g_strdup("get-text"));
+  const unsigned int number_of_pages = ddjvu_document_get_pagenum(document->document);
+
+  for (unsigned int run = 0; run < BENCH_RUNS; run++) {
+    for (unsigned int index = 0; index < number_of_pages; index++) {
+      /* the whole page in pixel coordinates of the text layer */
+      zathura_rectangle_t rectangle = {0, 0, geometries[index].width, geometries[index].height};
+
+      const gint64 start          = g_get_monotonic_time();
+      djvu_page_text_t* page_text = djvu_page_text_take(document, index);
+      if (page_text != NULL) {
+        g_free(djvu_page_text_select(page_text, rectangle));
+        djvu_page_text_return(document, page_text);
+      }
+      operation_add_sample(operation, start);
+    }
+  }
+}
+
+/* the outline is fetched and flattened as for djvu_document_index_generate,
+ * only the zathura index tree is left out */
+static void bench_index(djvu_document_t* document, GArray* operations) {
+  bench_operation_t* operation = operation_add(operations, g_strdup("index"));
+
+  for (unsigned int run = 0; run < BENCH_RUNS; run++) {
+    const gint64 start = g_get_monotonic_time();
+    GArray* entries    = djvu_document_get_outline(document);
+    if (entries != NULL) {
+      g_array_free(entries, TRUE);
+    }
+    operation_add_sample(operation, start);
+  }
+}
+
+static void print_json(const char* path, unsigned int number_of_pages, GArray* operations) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("{\n  \"document\": ");
+  print_json_string(path);
+  printf(",\n  \"pages\": %u,\n  \"peak_rss_kib\": %ld,\n  \"operations\": [\n", number_of_pages, usage.ru_maxrss);
+
+  for (guint i = 0; i < operations->len; i++) {
+    bench_operation_t* operation = &g_array_index(operations, bench_operation_t, i);
+    GArray* samples              = operation->samples;
+    g_array_sort(samples, compare_samples);
+
+    gint64 total = 0;
+    for (guint j = 0; j < samples->len; j++) {
+      total += g_array_index(samples, gint64, j);
+    }
+
+    const double seconds = total / (double)G_USEC_PER_SEC;
+    printf("    {\"name\": ");
+    print_json_string(operation->name);
+    printf(", \"count\": %u, \"per_second\": %.2f, \"mean_us\": %.1f, \"p50_us\": %" G_GINT64_FORMAT
+           ", \"p90_us\": %" G_GINT64_FORMAT ", \"p99_us\": %" G_GINT64_FORMAT ", \"max_us\": %" G_GINT64_FORMAT
+           "}%s\n",
+           samples->len, seconds > 0 ? samples->len / seconds : 0, samples->len > 0 ? total / (double)samples->len : 0,
+           get_percentile(samples, 50), get_percentile(samples, 90), get_percentile(samples, 99),
+           get_percentile(samples, 100), i + 1 < operations->len ? "," : "");
+  }
+
+  printf("  ]\n}\n");
+}
+
+static void print_json_string(const char* text) {
+  putchar('"');
+  for (const unsigned char* iter = (const unsigned char*)text; *iter != '\0'; iter++) {
+    if (*iter == '"' || *iter == '\\') {
+      printf("\\%c", *iter);
+    } else if (*iter < 0x20) {
+      printf("\\u%04x", *iter);
+    } else {
+      putchar(*iter);
+    }
+  }
+  putchar('"');
+}
+
+/* nearest rank on sorted samples */
+static gint64 get_percentile(GArray* samples, unsigned int percentile) {
+  if (samples->len == 0) {
+    return 0;
+  }
+
+  const guint rank = (guint)ceil(percentile / 100.0 * samples->len);
+  return g_array_index(samples, gint64, MAX(rank, 1) - 1);
+}
+
+static gint compare_samples(gconstpointer a, gconstpointer b) {
+  const gint64 first  = *(const gint64*)a;
+  const gint64 second = *(const gint64*)b;
+
+  return (first > second) - (first < second);
+}
@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "fuzz.h"
+#include "annotations.h"
+
+/* every expression is parsed as the annotations of a page */
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  minivar_t* expressions = minivar_alloc();
+  fuzz_read_expressions(data, size, expressions);
+
+  for (miniexp_t list = *minivar_pointer(expressions); miniexp_consp(list); list = miniexp_cdr(list)) {
+    GArray* links = djvu_annotations_parse_links(miniexp_car(list), FUZZ_NUMBER_OF_PAGES);
+    g_array_free(links, TRUE);
+  }
+
+  minivar_free(expressions);
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+
+#include "fuzz.h"
+
+void fuzz_read_expressions(const uint8_t* data, size_t size, minivar_t* expressions) {
+  *minivar_pointer(expressions) = miniexp_nil;
+
+  /* fmemopen rejects empty buffers */
+  if (data == NULL || size == 0) {
+    return;
+  }
+
+  FILE* file = fmemopen((void*)data, size, "r");
+  if (file == NULL) {
+    return;
+  }
+
+  miniexp_io_t io;
+  miniexp_io_init(&io);
+  miniexp_io_set_input(&io, file);
+
+  /* the expression has to survive the garbage collection in miniexp_cons */
+  minivar_t* expression = minivar_alloc();
+  for (unsigned int i = 0; i < FUZZ_MAX_EXPRESSIONS; i++) {
+    *minivar_pointer(expression) = miniexp_pread(&io);
+    if (*minivar_pointer(expression) == miniexp_dummy) {
+      break;
+    }
+
+    *minivar_pointer(expressions) = miniexp_cons(*minivar_pointer(expression), *minivar_pointer(expressions));
+  }
+
+  *minivar_pointer(expressions) = miniexp_reverse(*minivar_pointer(expressions));
+
+  minivar_free(expression);
+  fclose(file);
+}
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_FUZZ_H
+#define DJVU_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libdjvu/miniexp.h>
+
+#define FUZZ_MAX_EXPRESSIONS 16
+#define FUZZ_NUMBER_OF_PAGES 16
+
+/**
+ * Reads expressions from an input of the fuzzer the way libdjvu reads them
+ * from a document. Reading stops at the end of the input, at the first
+ * malformed expression or after FUZZ_MAX_EXPRESSIONS expressions.
+ *
+ * @param data The input
+ * @param size Size of the input
+ * @param expressions Variable that receives the list of expressions
+ */
+void fuzz_read_expressions(const uint8_t* data, size_t size, minivar_t* expressions);
+
+/**
+ * Runs a fuzz target on one input
+ *
+ * @param data The input
+ * @param size Size of the input
+ * @return Always 0
+ */
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#endif // DJVU_FUZZ_H
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "fuzz.h"
+
+/* driver for AFL and for replaying inputs without libFuzzer */
+
+static int run_file(const char* path) {
+  char* data    = NULL;
+  size_t size   = 0;
+  GError* error = NULL;
+  if (g_file_get_contents(path, &data, &size, &error) == FALSE) {
+    fprintf(stderr, "%s: %s\n", path, error->message);
+    g_error_free(error);
+    return EXIT_FAILURE;
+  }
+
+  LLVMFuzzerTestOneInput((const uint8_t*)data, size);
+  g_free(data);
+
+  return EXIT_SUCCESS;
+}
+
+static int run_stdin(void) {
+  GByteArray* data = g_byte_array_new();
+
+  guint8 buffer[4096];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+    g_byte_array_append(data, buffer, length);
+  }
+
+  LLVMFuzzerTestOneInput(data->data, data->len);
+  g_byte_array_unref(data);
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    return run_stdin();
+  }
+
+  int result = EXIT_SUCCESS;
+  for (int i = 1; i < argc; i++) {
+    if (run_file(argv[i]) != EXIT_SUCCESS) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "fuzz.h"
+#include "annotations.h"
+
+/* every expression is parsed as the outline of a document without page ids */
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  minivar_t* expressions = minivar_alloc();
+  fuzz_read_expressions(data, size, expressions);
+
+  for (miniexp_t list = *minivar_pointer(expressions); miniexp_consp(list); list = miniexp_cdr(list)) {
+    GArray* entries = djvu_annotations_parse_outline(miniexp_car(list), NULL, FUZZ_NUMBER_OF_PAGES);
+    if (entries != NULL) {
+      g_array_free(entries, TRUE);
+    }
+  }
+
+  minivar_free(expressions);
+
+  return 0;
+}
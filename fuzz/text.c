@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "fuzz.h"
+#include "page-text.h"
+
+#define FUZZ_PAGE_SIZE 1000
+
+/* the first expression is the text layer of a page, an optional string
+ * replaces the default query and an optional number rotates the page */
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  minivar_t* expressions = minivar_alloc();
+  fuzz_read_expressions(data, size, expressions);
+
+  miniexp_t list        = *minivar_pointer(expressions);
+  const char* query     = "a";
+  ddjvu_pageinfo_t info = {
+      .width    = FUZZ_PAGE_SIZE,
+      .height   = FUZZ_PAGE_SIZE,
+      .dpi      = 300,
+      .rotation = 0,
+      .version  = 0,
+  };
+
+  for (miniexp_t options = miniexp_cdr(list); miniexp_consp(options); options = miniexp_cdr(options)) {
+    miniexp_t option = miniexp_car(options);
+    if (miniexp_stringp(option)) {
+      query = miniexp_to_str(option);
+    } else if (miniexp_numberp(option)) {
+      info.rotation = miniexp_to_int(option) & 3;
+    }
+  }
+
+  djvu_page_text_t* page_text = djvu_page_text_new_from_expression(miniexp_car(list), &info);
+  if (page_text == NULL) {
+    goto error_free;
+  }
+
+  girara_list_t* results = djvu_page_text_search(page_text, query);
+  if (results != NULL) {
+    girara_list_free(results);
+  }
+
+  zathura_rectangle_t rectangle = {0, 0, FUZZ_PAGE_SIZE, FUZZ_PAGE_SIZE};
+  g_free(djvu_page_text_select(page_text, rectangle));
+
+  girara_list_t* lines = djvu_page_text_select_lines(page_text, rectangle);
+  if (lines != NULL) {
+    girara_list_free(lines);
+  }
+
+  djvu_page_text_free(page_text);
+
+error_free:
+
+  minivar_free(expressions);
+
+  return 0;
+}
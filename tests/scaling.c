@@ -0,0 +1,256 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include "annotations.h"
+#include "page-text.h"
+
+/* doubling the input must not take more than this factor of time */
+#define SCALING_MAX_RATIO 2.2
+#define SCALING_RUNS 5
+/* shorter timings are dominated by noise and are compared against this */
+#define SCALING_MIN_TIME 2000
+#define SCALING_WORDS_PER_LINE 10
+#define SCALING_WORD_WIDTH 100
+#define SCALING_LINE_HEIGHT 20
+
+/**
+ * Operation whose time has to grow at most linearly with its input
+ */
+typedef struct scaling_case_s {
+  const char* name;                                     /**< Name of the case */
+  unsigned int size;                                    /**< Number of elements of the smaller input */
+  void (*generate)(GString* source, unsigned int size); /**< Writes an input with size elements */
+  void (*run)(miniexp_t expression, unsigned int size); /**< Runs the operation on the parsed input */
+} scaling_case_t;
+
+/* forward declarations */
+static void generate_text(GString* source, unsigned int size);
+static void generate_links(GString* source, unsigned int size);
+static void generate_outline(GString* source, unsigned int size);
+static void run_search(miniexp_t expression, unsigned int size);
+static void run_select(miniexp_t expression, unsigned int size);
+static void run_select_lines(miniexp_t expression, unsigned int size);
+static void run_links(miniexp_t expression, unsigned int size);
+static void run_outline(miniexp_t expression, unsigned int size);
+static bool read_expression(GString* source, minivar_t* expression);
+static gint64 measure(const scaling_case_t* scaling_case, unsigned int size);
+static djvu_page_text_t* page_text_new(miniexp_t expression, unsigned int size);
+
+static const scaling_case_t cases[] = {
+    {"search", 50000, generate_text, run_search},
+    {"select", 50000, generate_text, run_select},
+    {"select-lines", 50000, generate_text, run_select_lines},
+    {"links", 5000, generate_links, run_links},
+    {"outline", 50000, generate_outline, run_outline},
+};
+
+int main(void) {
+  int result = EXIT_SUCCESS;
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS(cases); i++) {
+    const scaling_case_t* scaling_case = &cases[i];
+
+    const gint64 single_time = measure(scaling_case, scaling_case->size);
+    const gint64 double_time = measure(scaling_case, 2 * scaling_case->size);
+    if (single_time < 0 || double_time < 0) {
+      fprintf(stderr, "%s: could not read the generated input\n", scaling_case->name);
+      result = EXIT_FAILURE;
+      continue;
+    }
+
+    const double ratio = (double)double_time / MAX(single_time, SCALING_MIN_TIME);
+    const bool passed  = ratio <= SCALING_MAX_RATIO;
+
+    printf("%s: %u elements in %" G_GINT64_FORMAT " us, %u elements in %" G_GINT64_FORMAT " us, ratio %.2f%s\n",
+           scaling_case->name, scaling_case->size, single_time, 2 * scaling_case->size, double_time, ratio,
+           passed ? "" : " (too slow)");
+
+    if (passed == false) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Returns the best time of SCALING_RUNS runs of an operation
+ *
+ * @param scaling_case The operation
+ * @param size Number of elements of the input
+ * @return Time in microseconds or -1 if an error occurred
+ */
+static gint64 measure(const scaling_case_t* scaling_case, unsigned int size) {
+  GString* source = g_string_new(NULL);
+  scaling_case->generate(source, size);
+
+  minivar_t* expression = minivar_alloc();
+  if (read_expression(source, expression) == false) {
+    minivar_free(expression);
+    g_string_free(source, TRUE);
+    return -1;
+  }
+
+  g_string_free(source, TRUE);
+
+  gint64 best = G_MAXINT64;
+  for (unsigned int run = 0; run < SCALING_RUNS; run++) {
+    const gint64 start = g_get_monotonic_time();
+    scaling_case->run(*minivar_pointer(expression), size);
+    best = MIN(best, g_get_monotonic_time() - start);
+  }
+
+  minivar_free(expression);
+
+  return best;
+}
+
+static bool read_expression(GString* source, minivar_t* expression) {
+  FILE* file = fmemopen(source->str, source->len, "r");
+  if (file == NULL) {
+    return false;
+  }
+
+  miniexp_io_t io;
+  miniexp_io_init(&io);
+  miniexp_io_set_input(&io, file);
+
+  *minivar_pointer(expression) = miniexp_pread(&io);
+  fclose(file);
+
+  return *minivar_pointer(expression) != miniexp_dummy;
+}
+
+/* a page of lines with SCALING_WORDS_PER_LINE words each, every tenth word
+ * matches the search query */
+static void generate_text(GString* source, unsigned int size) {
+  const unsigned int lines  = (size + SCALING_WORDS_PER_LINE - 1) / SCALING_WORDS_PER_LINE;
+  const unsigned int width  = SCALING_WORDS_PER_LINE * SCALING_WORD_WIDTH;
+  const unsigned int height = lines * SCALING_LINE_HEIGHT;
+
+  g_string_append_printf(source, "(page 0 0 %u %u", width, height);
+  for (unsigned int line = 0; line < lines; line++) {
+    const unsigned int y = height - (line + 1) * SCALING_LINE_HEIGHT;
+    g_string_append_printf(source, "\n (line 0 %u %u %u", y, width, y + SCALING_LINE_HEIGHT);
+
+    for (unsigned int column = 0; column < SCALING_WORDS_PER_LINE; column++) {
+      const unsigned int word = line * SCALING_WORDS_PER_LINE + column;
+      const unsigned int x    = column * SCALING_WORD_WIDTH;
+      g_string_append_printf(source, " (word %u %u %u %u ", x, y, x + SCALING_WORD_WIDTH, y + SCALING_LINE_HEIGHT);
+
+      if (word % 10 == 0) {
+        g_string_append(source, "\"lorem\")");
+      } else {
+        g_string_append_printf(source, "\"w%u\")", word);
+      }
+    }
+
+    g_string_append_c(source, ')');
+  }
+
+  g_string_append_c(source, ')');
+}
+
+/* page annotations with alternating links to pages and to web addresses */
+static void generate_links(GString* source, unsigned int size) {
+  g_string_append_c(source, '(');
+  for (unsigned int link = 0; link < size; link++) {
+    if (link % 2 == 0) {
+      g_string_append_printf(source, "\n (maparea \"#p%u\" \"\"", link + 1);
+    } else {
+      g_string_append_printf(source, "\n (maparea (url \"https://example.org/%u\" \"_blank\") \"\"", link);
+    }
+
+    g_string_append_printf(source, " (rect %u %u 10 10))", (link % 100) * 10, (link / 100) * 10);
+  }
+
+  g_string_append_c(source, ')');
+}
+
+/* an outline of chapters with SCALING_WORDS_PER_LINE sections each */
+static void generate_outline(GString* source, unsigned int size) {
+  g_string_append(source, "(bookmarks");
+  for (unsigned int entry = 0; entry < size; entry += SCALING_WORDS_PER_LINE) {
+    g_string_append_printf(source, "\n (\"Chapter %u\" \"#%u\"", entry, entry + 1);
+
+    for (unsigned int section = entry + 1; section < MIN(entry + SCALING_WORDS_PER_LINE, size); section++) {
+      g_string_append_printf(source, " (\"Section %u\" \"#%u\")", section, section + 1);
+    }
+
+    g_string_append_c(source, ')');
+  }
+
+  g_string_append_c(source, ')');
+}
+
+static djvu_page_text_t* page_text_new(miniexp_t expression, unsigned int size) {
+  const unsigned int lines   = (size + SCALING_WORDS_PER_LINE - 1) / SCALING_WORDS_PER_LINE;
+  ddjvu_pageinfo_t page_info = {
+      .width    = SCALING_WORDS_PER_LINE * SCALING_WORD_WIDTH,
+      .height   = lines * SCALING_LINE_HEIGHT,
+      .dpi      = 300,
+      .rotation = 0,
+      .version  = 0,
+  };
+
+  return djvu_page_text_new_from_expression(expression, &page_info);
+}
+
+static void run_search(miniexp_t expression, unsigned int size) {
+  djvu_page_text_t* page_text = page_text_new(expression, size);
+  if (page_text == NULL) {
+    return;
+  }
+
+  girara_list_t* results = djvu_page_text_search(page_text, "lorem");
+  if (results != NULL) {
+    girara_list_free(results);
+  }
+
+  djvu_page_text_free(page_text);
+}
+
+static void run_select(miniexp_t expression, unsigned int size) {
+  djvu_page_text_t* page_text = page_text_new(expression, size);
+  if (page_text == NULL) {
+    return;
+  }
+
+  const unsigned int lines      = (size + SCALING_WORDS_PER_LINE - 1) / SCALING_WORDS_PER_LINE;
+  zathura_rectangle_t rectangle = {0, 0, SCALING_WORDS_PER_LINE * SCALING_WORD_WIDTH, lines * SCALING_LINE_HEIGHT};
+  g_free(djvu_page_text_select(page_text, rectangle));
+
+  djvu_page_text_free(page_text);
+}
+
+static void run_select_lines(miniexp_t expression, unsigned int size) {
+  djvu_page_text_t* page_text = page_text_new(expression, size);
+  if (page_text == NULL) {
+    return;
+  }
+
+  const unsigned int lines      = (size + SCALING_WORDS_PER_LINE - 1) / SCALING_WORDS_PER_LINE;
+  zathura_rectangle_t rectangle = {0, 0, SCALING_WORDS_PER_LINE * SCALING_WORD_WIDTH, lines * SCALING_LINE_HEIGHT};
+  girara_list_t* list           = djvu_page_text_select_lines(page_text, rectangle);
+  if (list != NULL) {
+    girara_list_free(list);
+  }
+
+  djvu_page_text_free(page_text);
+}
+
+static void run_links(miniexp_t expression, unsigned int size) {
+  GArray* links = djvu_annotations_parse_links(expression, size);
+  g_array_free(links, TRUE);
+}
+
+static void run_outline(miniexp_t expression, unsigned int size) {
+  GArray* entries = djvu_annotations_parse_outline(expression, NULL, size);
+  if (entries != NULL) {
+    g_array_free(entries, TRUE);
+  }
+}
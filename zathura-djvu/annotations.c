@@ -0,0 +1,364 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "annotations.h"
+#include "cache.h"
+#include "memory.h"
+#include "internal.h"
+
+/**
+ * State of flattening an outline
+ */
+typedef struct outline_parser_s {
+  GArray* entries;              /**< Entries found so far */
+  ddjvu_document_t* document;   /**< Document used to resolve page ids or NULL */
+  unsigned int number_of_pages; /**< Number of pages of the document */
+  GHashTable* page_ids;         /**< Page numbers by page id, built on first use */
+} outline_parser_t;
+
+/* forward declarations */
+static void parse_outline(outline_parser_t* parser, miniexp_t expression, unsigned int depth);
+static GHashTable* build_page_ids(ddjvu_document_t* document);
+static bool exp_to_str(miniexp_t expression, const char** string);
+static bool exp_to_int(miniexp_t expression, int* integer);
+static bool exp_to_rect(miniexp_t expression, zathura_rectangle_t* rect);
+
+GArray* djvu_annotations_parse_links(miniexp_t annotations, unsigned int number_of_pages) {
+  GArray* links = g_array_new(FALSE, FALSE, sizeof(djvu_link_t));
+
+  miniexp_t* hyperlinks = ddjvu_anno_get_hyperlinks(annotations);
+  if (hyperlinks == NULL) {
+    return links;
+  }
+
+  /* symbols are interned, so look them up once for all links */
+  const miniexp_t symbol_maparea = miniexp_symbol("maparea");
+  const miniexp_t symbol_url     = miniexp_symbol("url");
+
+  for (miniexp_t* iter = hyperlinks; *iter != NULL; iter++) {
+    if (miniexp_consp(*iter) == 0 || miniexp_car(*iter) != symbol_maparea) {
+      continue;
+    }
+
+    miniexp_t inner = miniexp_cdr(*iter);
+
+    /* extract url information */
+    const char* target_string = NULL;
+
+    /* (url "href" "target") carries the address in its first argument */
+    if (miniexp_caar(inner) == symbol_url) {
+      if (exp_to_str(miniexp_cadr(miniexp_car(inner)), &target_string) == false) {
+        continue;
+      }
+    } else {
+      if (exp_to_str(miniexp_car(inner), &target_string) == false) {
+        continue;
+      }
+    }
+
+    /* skip comment */
+    inner = miniexp_cdr(inner);
+
+    /* extract link area */
+    inner = miniexp_cdr(inner);
+
+    djvu_link_t link = {.page = -1};
+    if (exp_to_rect(miniexp_car(inner), &link.rectangle) == false) {
+      continue;
+    }
+
+    /* goto page */
+    if (target_string[0] == '#' && target_string[1] == 'p') {
+      const int page_number = atoi(target_string + 2) - 1;
+      if (page_number < 0 || (unsigned int)page_number >= number_of_pages) {
+        continue;
+      }
+
+      link.page = page_number;
+      /* url or other? */
+    } else if (strstr(target_string, "//") != NULL) {
+      link.uri = target_string;
+      /* TODO: Parse all different links */
+    } else {
+      continue;
+    }
+
+    g_array_append_val(links, link);
+  }
+
+  free(hyperlinks);
+
+  return links;
+}
+
+GArray* djvu_annotations_parse_outline(miniexp_t outline, ddjvu_document_t* document, unsigned int number_of_pages) {
+  if (miniexp_consp(outline) == 0 || miniexp_car(outline) != miniexp_symbol("bookmarks")) {
+    return NULL;
+  }
+
+  outline_parser_t parser = {
+      .entries         = g_array_new(FALSE, FALSE, sizeof(djvu_outline_entry_t)),
+      .document        = document,
+      .number_of_pages = number_of_pages,
+  };
+
+  parse_outline(&parser, miniexp_cdr(outline), 0);
+
+  if (parser.page_ids != NULL) {
+    g_hash_table_destroy(parser.page_ids);
+  }
+
+  return parser.entries;
+}
+
+djvu_annotations_t* djvu_annotations_take(djvu_document_t* djvu_document, unsigned int index) {
+  if (djvu_document == NULL || djvu_document->document == NULL) {
+    return NULL;
+  }
+
+  djvu_annotations_t* annotations = djvu_cache_take(djvu_document->annotations, index);
+  if (annotations != NULL) {
+    return annotations;
+  }
+
+  miniexp_t expression = miniexp_nil;
+  while ((expression = ddjvu_document_get_pageanno(djvu_document->document, index)) == miniexp_dummy) {
+    handle_messages(djvu_document, true);
+  }
+
+  if (expression == miniexp_nil) {
+    return NULL;
+  }
+
+  annotations = calloc(1, sizeof(djvu_annotations_t));
+  if (annotations == NULL) {
+    ddjvu_miniexp_release(djvu_document->document, expression);
+    return NULL;
+  }
+
+  annotations->document    = djvu_document;
+  annotations->index       = index;
+  annotations->annotations = expression;
+  annotations->size        = sizeof(djvu_annotations_t) + djvu_memory_get_expression_size(expression);
+
+  return annotations;
+}
+
+void djvu_annotations_return(djvu_document_t* djvu_document, djvu_annotations_t* annotations) {
+  if (djvu_document == NULL || annotations == NULL) {
+    return;
+  }
+
+  djvu_cache_insert(djvu_document->annotations, annotations->index, annotations, annotations->size);
+}
+
+void djvu_annotations_free(djvu_annotations_t* annotations) {
+  if (annotations == NULL) {
+    return;
+  }
+
+  ddjvu_miniexp_release(annotations->document->document, annotations->annotations);
+  free(annotations);
+}
+
+static void parse_outline(outline_parser_t* parser, miniexp_t expression, unsigned int depth) {
+  /* malformed outlines must not exhaust the stack */
+  if (depth >= ZATHURA_DJVU_MAX_OUTLINE_DEPTH) {
+    return;
+  }
+
+  for (; miniexp_consp(expression) != 0; expression = miniexp_cdr(expression)) {
+    miniexp_t inner = miniexp_car(expression);
+
+    if (miniexp_consp(inner) == 0 || miniexp_consp(miniexp_cdr(inner)) == 0 ||
+        miniexp_stringp(miniexp_car(inner)) == 0 || miniexp_stringp(miniexp_cadr(inner)) == 0) {
+      continue;
+    }
+
+    const char* name = miniexp_to_str(miniexp_car(inner));
+    const char* link = miniexp_to_str(miniexp_cadr(inner));
+
+    /* TODO: handle other links? */
+    if (name == NULL || link == NULL || link[0] != '#') {
+      continue;
+    }
+
+    /* Check if link+1 contains a number */
+    bool number = link[1] != '\0';
+    for (const char* iter = link + 1; *iter != '\0'; iter++) {
+      if (!isdigit((unsigned char)*iter)) {
+        number = false;
+        break;
+      }
+    }
+
+    /* if link starts with a number assume it is a number */
+    int page_number = -1;
+    if (number == true) {
+      page_number = atoi(link + 1) - 1;
+    } else {
+      /* otherwise assume it is an id for a page */
+      if (parser->page_ids == NULL) {
+        parser->page_ids = build_page_ids(parser->document);
+      }
+
+      /* got a page */
+      gpointer pageno = NULL;
+      if (g_hash_table_lookup_extended(parser->page_ids, link + 1, NULL, &pageno) == FALSE) {
+        /* give up */
+        continue;
+      }
+
+      page_number = GPOINTER_TO_INT(pageno);
+    }
+
+    if (page_number < 0 || (unsigned int)page_number >= parser->number_of_pages) {
+      continue;
+    }
+
+    djvu_outline_entry_t entry = {
+        .title = name,
+        .page  = page_number,
+        .depth = depth,
+    };
+    g_array_append_val(parser->entries, entry);
+
+    /* search recursive */
+    parse_outline(parser, miniexp_cddr(inner), depth + 1);
+  }
+}
+
+static GHashTable* build_page_ids(ddjvu_document_t* document) {
+  /* the ids are owned by the document */
+  GHashTable* page_ids = g_hash_table_new(g_str_hash, g_str_equal);
+  if (document == NULL) {
+    return page_ids;
+  }
+
+  const int fileno = ddjvu_document_get_filenum(document);
+  for (int i = 0; i < fileno; i++) {
+    ddjvu_fileinfo_t info;
+    if (ddjvu_document_get_fileinfo(document, i, &info) != DDJVU_JOB_OK) {
+      continue;
+    }
+
+    if (info.id != NULL && info.pageno >= 0 && g_hash_table_contains(page_ids, info.id) == FALSE) {
+      g_hash_table_insert(page_ids, (gpointer)info.id, GINT_TO_POINTER(info.pageno));
+    }
+  }
+
+  return page_ids;
+}
+
+static bool exp_to_str(miniexp_t expression, const char** string) {
+  if (string == NULL) {
+    return false;
+  }
+
+  if (miniexp_stringp(expression)) {
+    *string = miniexp_to_str(expression);
+    return true;
+  }
+
+  return false;
+}
+
+static bool exp_to_int(miniexp_t expression, int* integer) {
+  if (integer == NULL) {
+    return false;
+  }
+
+  if (miniexp_numberp(expression)) {
+    *integer = miniexp_to_int(expression);
+    return true;
+  }
+
+  return false;
+}
+
+static bool exp_to_rect(miniexp_t expression, zathura_rectangle_t* rect) {
+  if (rect == NULL || miniexp_consp(expression) == 0) {
+    return false;
+  }
+
+  miniexp_t shape = miniexp_car(expression);
+
+  if ((shape == miniexp_symbol("rect") || shape == miniexp_symbol("oval")) && miniexp_length(expression) == 5) {
+    int min_x  = 0;
+    int min_y  = 0;
+    int width  = 0;
+    int height = 0;
+
+    miniexp_t iter = miniexp_cdr(expression);
+    if (exp_to_int(miniexp_car(iter), &min_x) == false) {
+      return false;
+    }
+    iter = miniexp_cdr(iter);
+    if (exp_to_int(miniexp_car(iter), &min_y) == false) {
+      return false;
+    }
+    iter = miniexp_cdr(iter);
+    if (exp_to_int(miniexp_car(iter), &width) == false) {
+      return false;
+    }
+    iter = miniexp_cdr(iter);
+    if (exp_to_int(miniexp_car(iter), &height) == false) {
+      return false;
+    }
+
+    if (width < 0 || height < 0) {
+      return false;
+    }
+
+    rect->x1 = min_x;
+    rect->x2 = (double)min_x + width;
+    rect->y1 = min_y;
+    rect->y2 = (double)min_y + height;
+  } else if (shape == miniexp_symbol("poly")) {
+    /* a polygon needs at least three points given as pairs of coordinates */
+    const int length = miniexp_length(expression);
+    if (length < 7 || (length - 1) % 2 != 0) {
+      return false;
+    }
+
+    int min_x = G_MAXINT;
+    int min_y = G_MAXINT;
+    int max_x = G_MININT;
+    int max_y = G_MININT;
+
+    miniexp_t iter = miniexp_cdr(expression);
+    while (miniexp_consp(iter) != 0) {
+      int x = 0;
+      int y = 0;
+
+      if (exp_to_int(miniexp_car(iter), &x) == false) {
+        return false;
+      }
+      iter = miniexp_cdr(iter);
+      if (exp_to_int(miniexp_car(iter), &y) == false) {
+        return false;
+      }
+      iter = miniexp_cdr(iter);
+
+      min_x = MIN(min_x, x);
+      min_y = MIN(min_y, y);
+      max_x = MAX(max_x, x);
+      max_y = MAX(max_y, y);
+    }
+
+    rect->x1 = min_x;
+    rect->x2 = max_x;
+    rect->y1 = min_y;
+    rect->y2 = max_y;
+  } else {
+    /* unknown or malformed shape */
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_ANNOTATIONS_H
+#define DJVU_ANNOTATIONS_H
+
+#include <stddef.h>
+#include <glib.h>
+#include <libdjvu/miniexp.h>
+
+#include "djvu.h"
+
+/**
+ * Annotations of a page
+ */
+typedef struct djvu_annotations_s {
+  djvu_document_t* document; /**< Correspondening document */
+  unsigned int index;        /**< Index of the correspondening page */
+  miniexp_t annotations;     /**< Annotations by ddjvu_document_get_pageanno */
+  size_t size;               /**< Estimated size of the annotations */
+} djvu_annotations_t;
+
+/**
+ * Hyperlink of a page
+ */
+typedef struct djvu_link_s {
+  zathura_rectangle_t rectangle; /**< Area in pixel coordinates of the text layer */
+  int page;                      /**< Index of the target page or -1 for external links */
+  const char* uri;               /**< Address of external links, owned by the annotations */
+} djvu_link_t;
+
+/**
+ * Entry of the outline of a document
+ */
+typedef struct djvu_outline_entry_s {
+  const char* title;  /**< Title, owned by the outline */
+  int page;           /**< Index of the target page */
+  unsigned int depth; /**< Nesting depth, 0 for top level entries */
+} djvu_outline_entry_t;
+
+/**
+ * Extracts the hyperlinks of a page. Links with unsupported targets or
+ * malformed areas and links to pages outside of the document are skipped.
+ *
+ * @param annotations Annotations as returned by ddjvu_document_get_pageanno
+ * @param number_of_pages Number of pages of the document
+ * @return Array of djvu_link_t (needs to be deallocated with g_array_free)
+ */
+GArray* djvu_annotations_parse_links(miniexp_t annotations, unsigned int number_of_pages);
+
+/**
+ * Flattens the outline of a document. Entries are listed in pre-order, so
+ * the parent of an entry is the closest preceding entry one level up.
+ * Entries that do not point to a page of the document are skipped together
+ * with their children, as are entries nested deeper than
+ * ZATHURA_DJVU_MAX_OUTLINE_DEPTH.
+ *
+ * @param outline Outline as returned by ddjvu_document_get_outline
+ * @param document Document used to resolve links to page ids or NULL
+ * @param number_of_pages Number of pages of the document
+ * @return Array of djvu_outline_entry_t (needs to be deallocated with
+ *   g_array_free) or NULL if the expression is not an outline
+ */
+GArray* djvu_annotations_parse_outline(miniexp_t outline, ddjvu_document_t* document, unsigned int number_of_pages);
+
+/**
+ * Returns the annotations of a page. Annotations that have been used before
+ * are taken out of the annotation cache of the document, all others are
+ * fetched from libdjvu.
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @return The annotations (release with djvu_annotations_return) or NULL if
+ *   the page has no annotations or an error occurred
+ */
+djvu_annotations_t* djvu_annotations_take(djvu_document_t* document, unsigned int index);
+
+/**
+ * Puts the annotations of a page back into the annotation cache
+ *
+ * @param document The document
+ * @param annotations The annotations
+ */
+void djvu_annotations_return(djvu_document_t* document, djvu_annotations_t* annotations);
+
+/**
+ * Frees the annotations of a page
+ *
+ * @param annotations The annotations
+ */
+void djvu_annotations_free(djvu_annotations_t* annotations);
+
+#endif // DJVU_ANNOTATIONS_H
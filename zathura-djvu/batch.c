@@ -0,0 +1,362 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "document.h"
+#include "export.h"
+#include "page-text.h"
+#include "stats.h"
+#include "trace.h"
+#include "internal.h"
+
+/**
+ * State for printing the hits of a search
+ */
+typedef struct search_result_s {
+  GString* output;    /**< Output of the current file */
+  const char* path;   /**< Path of the current file */
+  unsigned int index; /**< Index of the current page */
+  double scale;       /**< Points per pixel of the current page */
+} search_result_t;
+
+static gboolean option_geometry   = FALSE;
+static char* option_text          = NULL;
+static char* option_search        = NULL;
+static char* option_render        = NULL;
+static gboolean option_postscript = FALSE;
+static char* option_pages         = NULL;
+static char* option_output        = NULL;
+static int option_jobs            = 1;
+
+static GOptionEntry entries[] = {
+    {"geometry", 'g', 0, G_OPTION_ARG_NONE, &option_geometry, "Print the size of every page", NULL},
+    {"text", 't', 0, G_OPTION_ARG_STRING, &option_text, "Extract the text layer as text, hocr or json", "FORMAT"},
+    {"search", 's', 0, G_OPTION_ARG_STRING, &option_search, "Print the boxes of all occurrences of TEXT", "TEXT"},
+    {"render", 'r', 0, G_OPTION_ARG_STRING, &option_render, "Export the pages as png or ppm images", "FORMAT"},
+    {"postscript", 'P', 0, G_OPTION_ARG_NONE, &option_postscript, "Convert the pages to PostScript", NULL},
+    {"pages", 'p', 0, G_OPTION_ARG_STRING, &option_pages, "Only process the given pages, e.g. 1-10,15", "PAGES"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &option_output, "Write exported files to DIRECTORY", "DIRECTORY"},
+    {"jobs", 'j', 0, G_OPTION_ARG_INT, &option_jobs, "Process up to N files concurrently", "N"},
+    {NULL, 0, 0, 0, NULL, NULL, NULL},
+};
+
+static djvu_export_format_t text_format;
+static const char* text_extension;
+static djvu_export_format_t render_format;
+static const char* render_extension;
+
+static GMutex output_lock;
+static int failed = 0;
+
+/* set by the first SIGINT, the second one terminates the tool right away */
+static volatile sig_atomic_t interrupted = 0;
+
+/* forward declarations */
+static void process_file(gpointer data, gpointer user_data);
+static void handle_interrupt(int signal);
+static bool export_postscript(djvu_document_t* document, const char* output_path);
+static bool print_geometry(djvu_document_t* document, const char* path, GArray* pages, GString* output);
+static bool print_search(djvu_document_t* document, const char* path, GArray* pages, GString* output);
+static void print_search_result(void* data, void* user_data);
+static bool check_output_paths(int argc, char* argv[]);
+static char* get_output_stem(const char* path);
+static char* get_output_path(const char* path, const char* extension);
+
+int main(int argc, char* argv[]) {
+  GError* error           = NULL;
+  GOptionContext* context = g_option_context_new("FILE...");
+  g_option_context_add_main_entries(context, entries, NULL);
+  g_option_context_set_summary(context, "Runs batch operations on DjVu documents without a display.");
+
+  if (g_option_context_parse(context, &argc, &argv, &error) == FALSE) {
+    g_printerr("%s\n", error->message);
+    g_error_free(error);
+    g_option_context_free(context);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free(context);
+
+  if (argc < 2) {
+    g_printerr("no input files\n");
+    return EXIT_FAILURE;
+  }
+
+  if (option_text != NULL) {
+    if (g_strcmp0(option_text, "text") == 0) {
+      text_format    = DJVU_EXPORT_TEXT;
+      text_extension = "txt";
+    } else if (g_strcmp0(option_text, "hocr") == 0) {
+      text_format    = DJVU_EXPORT_HOCR;
+      text_extension = "hocr";
+    } else if (g_strcmp0(option_text, "json") == 0) {
+      text_format    = DJVU_EXPORT_JSON;
+      text_extension = "json";
+    } else {
+      g_printerr("unknown text format: %s\n", option_text);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (option_render != NULL) {
+    if (g_strcmp0(option_render, "png") == 0) {
+      render_format    = DJVU_EXPORT_PNG;
+      render_extension = "png";
+    } else if (g_strcmp0(option_render, "ppm") == 0) {
+      render_format    = DJVU_EXPORT_PNM;
+      render_extension = "ppm";
+    } else {
+      g_printerr("unknown image format: %s\n", option_render);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* outputs are named after the input, so inputs must not share a name */
+  if ((option_text != NULL || option_render != NULL || option_postscript == TRUE) &&
+      check_output_paths(argc, argv) == false) {
+    return EXIT_FAILURE;
+  }
+
+  /* the export functions read the page selection from the environment */
+  if (option_pages != NULL) {
+    g_setenv("ZATHURA_DJVU_PAGES", option_pages, TRUE);
+  }
+
+  /* an interrupt cancels running conversions, so no partial files are left */
+  struct sigaction action = {0};
+  action.sa_handler       = handle_interrupt;
+  action.sa_flags         = SA_RESETHAND;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+
+  /* every file gets its own document and decoder */
+  GThreadPool* pool = g_thread_pool_new(process_file, NULL, MAX(option_jobs, 1), TRUE, NULL);
+  if (pool == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    g_thread_pool_push(pool, argv[i], NULL);
+  }
+
+  g_thread_pool_free(pool, FALSE, TRUE);
+
+  /* statistics and events of all files */
+  djvu_stats_dump();
+  djvu_trace_write();
+
+  return (g_atomic_int_get(&failed) == 0 && interrupted == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void handle_interrupt(int UNUSED(signal)) {
+  interrupted = 1;
+}
+
+static void process_file(gpointer data, gpointer UNUSED(user_data)) {
+  const char* path = data;
+
+  /* files that are still queued are skipped after an interrupt */
+  if (interrupted != 0) {
+    return;
+  }
+
+  zathura_error_t error     = ZATHURA_ERROR_OK;
+  djvu_document_t* document = djvu_document_new(path, &error);
+  if (document == NULL) {
+    g_printerr("%s: could not open document\n", path);
+    g_atomic_int_set(&failed, 1);
+    return;
+  }
+
+  GArray* pages = djvu_export_get_pages(document);
+  if (pages == NULL) {
+    g_printerr("%s: invalid page selection\n", path);
+    g_atomic_int_set(&failed, 1);
+    djvu_document_destroy(document);
+    return;
+  }
+
+  /* output of concurrent jobs must not interleave */
+  GString* output = g_string_new(NULL);
+  bool success    = true;
+
+  if (option_geometry == TRUE) {
+    success = print_geometry(document, path, pages, output) && success;
+  }
+
+  if (option_search != NULL) {
+    success = print_search(document, path, pages, output) && success;
+  }
+
+  if (option_text != NULL) {
+    char* output_path = get_output_path(path, text_extension);
+    if (djvu_export_text(document, output_path, text_format) != ZATHURA_ERROR_OK) {
+      g_printerr("%s: could not write %s\n", path, output_path);
+      success = false;
+    }
+    g_free(output_path);
+  }
+
+  if (option_render != NULL) {
+    char* output_path = get_output_path(path, render_extension);
+    if (djvu_export_images(document, output_path, render_format) != ZATHURA_ERROR_OK) {
+      g_printerr("%s: could not write %s\n", path, output_path);
+      success = false;
+    }
+    g_free(output_path);
+  }
+
+  if (option_postscript == TRUE) {
+    char* output_path = get_output_path(path, "ps");
+    if (export_postscript(document, output_path) == false) {
+      g_printerr("%s: could not write %s\n", path, output_path);
+      success = false;
+    }
+    g_free(output_path);
+  }
+
+  g_mutex_lock(&output_lock);
+  fputs(output->str, stdout);
+  fflush(stdout);
+  g_mutex_unlock(&output_lock);
+
+  if (success == false) {
+    g_atomic_int_set(&failed, 1);
+  }
+
+  g_string_free(output, TRUE);
+  g_array_free(pages, TRUE);
+  djvu_document_destroy(document);
+}
+
+static bool export_postscript(djvu_document_t* document, const char* output_path) {
+  char** options        = djvu_export_get_options(DJVU_EXPORT_POSTSCRIPT, output_path);
+  zathura_error_t error = ZATHURA_ERROR_OK;
+  djvu_export_t* export = djvu_export_start(document, output_path, DJVU_EXPORT_POSTSCRIPT,
+                                            (const char* const*)options, NULL, NULL, &error);
+  g_strfreev(options);
+  if (export == NULL) {
+    return false;
+  }
+
+  /* the wait for messages is bounded, so interrupts are noticed quickly */
+  while (djvu_export_done(export) == false) {
+    if (interrupted != 0) {
+      djvu_export_cancel(export);
+      break;
+    }
+
+    handle_messages(document, true);
+  }
+
+  return djvu_export_finish(export) == ZATHURA_ERROR_OK;
+}
+
+static bool print_geometry(djvu_document_t* document, const char* path, GArray* pages, GString* output) {
+  for (guint i = 0; i < pages->len; i++) {
+    const unsigned int index = g_array_index(pages, unsigned int, i);
+
+    ddjvu_status_t status;
+    ddjvu_pageinfo_t page_info;
+    while ((status = ddjvu_document_get_pageinfo(document->document, index, &page_info)) < DDJVU_JOB_OK) {
+      handle_messages(document, true);
+    }
+
+    if (status >= DDJVU_JOB_FAILED) {
+      g_printerr("%s: could not read page %u\n", path, index + 1);
+      return false;
+    }
+
+    /* path, page, width, height, resolution, rotation */
+    g_string_append_printf(output, "%s\t%u\t%d\t%d\t%d\t%d\n", path, index + 1, page_info.width, page_info.height,
+                           page_info.dpi, page_info.rotation * 90);
+  }
+
+  return true;
+}
+
+static bool print_search(djvu_document_t* document, const char* path, GArray* pages, GString* output) {
+  for (guint i = 0; i < pages->len; i++) {
+    const unsigned int index = g_array_index(pages, unsigned int, i);
+
+    /* pages without a text layer have no hits */
+    djvu_page_text_t* page_text = djvu_page_text_new(document, index);
+    if (page_text == NULL) {
+      continue;
+    }
+
+    girara_list_t* results = djvu_page_text_search(page_text, option_search);
+    if (results != NULL) {
+      search_result_t result = {
+          .output = output,
+          .path   = path,
+          .index  = index,
+          .scale  = page_text->geometry.scale,
+      };
+      girara_list_foreach(results, print_search_result, &result);
+      girara_list_free(results);
+    }
+
+    djvu_page_text_free(page_text);
+  }
+
+  return true;
+}
+
+static void print_search_result(void* data, void* user_data) {
+  const zathura_rectangle_t* rectangle = data;
+  search_result_t* result              = user_data;
+
+  /* path, page, box in pixels with the origin in the top left corner */
+  g_string_append_printf(result->output, "%s\t%u\t%ld\t%ld\t%ld\t%ld\n", result->path, result->index + 1,
+                         lround(rectangle->x1 / result->scale), lround(rectangle->y1 / result->scale),
+                         lround(rectangle->x2 / result->scale), lround(rectangle->y2 / result->scale));
+}
+
+static bool check_output_paths(int argc, char* argv[]) {
+  GHashTable* stems = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  bool result       = true;
+
+  for (int i = 1; i < argc; i++) {
+    char* stem          = get_output_stem(argv[i]);
+    const char* earlier = g_hash_table_lookup(stems, stem);
+    if (earlier != NULL) {
+      g_printerr("%s and %s would be exported to the same files\n", earlier, argv[i]);
+      g_free(stem);
+      result = false;
+      continue;
+    }
+
+    g_hash_table_insert(stems, stem, argv[i]);
+  }
+
+  g_hash_table_destroy(stems);
+
+  return result;
+}
+
+static char* get_output_stem(const char* path) {
+  char* basename = g_path_get_basename(path);
+
+  char* dot = strrchr(basename, '.');
+  if (dot != NULL && dot != basename) {
+    *dot = '\0';
+  }
+
+  return basename;
+}
+
+static char* get_output_path(const char* path, const char* extension) {
+  char* stem        = get_output_stem(path);
+  char* filename    = g_strdup_printf("%s.%s", stem, extension);
+  char* output_path = g_build_filename(option_output != NULL ? option_output : ".", filename, NULL);
+
+  g_free(filename);
+  g_free(stem);
+
+  return output_path;
+}
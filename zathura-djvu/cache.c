@@ -0,0 +1,236 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdlib.h>
+
+#include "cache.h"
+
+/**
+ * Cache entry
+ */
+typedef struct djvu_cache_entry_s {
+  gint64 key;  /**< Key */
+  void* value; /**< Value */
+  size_t size; /**< Size of the value */
+  GList link;  /**< Position in the LRU queue */
+} djvu_cache_entry_t;
+
+struct djvu_cache_s {
+  GMutex lock;                  /**< Lock */
+  GHashTable* entries;          /**< Key to entry mapping */
+  GQueue lru;                   /**< Entries, most recently used first */
+  size_t size;                  /**< Accumulated size */
+  size_t max_size;              /**< Size limit */
+  GDestroyNotify free_function; /**< Value free function */
+};
+
+/* forward declarations */
+static void djvu_cache_entry_free(djvu_cache_t* cache, djvu_cache_entry_t* entry);
+static void djvu_cache_unlink(djvu_cache_t* cache, djvu_cache_entry_t* entry);
+static void djvu_cache_evict(djvu_cache_t* cache, size_t max_size);
+
+djvu_cache_t* djvu_cache_new(size_t max_size, GDestroyNotify free_function) {
+  djvu_cache_t* cache = calloc(1, sizeof(djvu_cache_t));
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  g_mutex_init(&cache->lock);
+  g_queue_init(&cache->lru);
+  cache->entries       = g_hash_table_new(g_int64_hash, g_int64_equal);
+  cache->max_size      = max_size;
+  cache->free_function = free_function;
+
+  return cache;
+}
+
+void djvu_cache_free(djvu_cache_t* cache) {
+  if (cache == NULL) {
+    return;
+  }
+
+  djvu_cache_evict(cache, 0);
+  g_hash_table_destroy(cache->entries);
+  g_mutex_clear(&cache->lock);
+  free(cache);
+}
+
+void djvu_cache_insert(djvu_cache_t* cache, uint64_t key, void* value, size_t size) {
+  if (cache == NULL || value == NULL) {
+    return;
+  }
+
+  djvu_cache_entry_t* entry = calloc(1, sizeof(djvu_cache_entry_t));
+  if (entry == NULL) {
+    if (cache->free_function != NULL) {
+      cache->free_function(value);
+    }
+    return;
+  }
+
+  entry->key       = key;
+  entry->value     = value;
+  entry->size      = size;
+  entry->link.data = entry;
+
+  g_mutex_lock(&cache->lock);
+
+  djvu_cache_entry_t* previous = g_hash_table_lookup(cache->entries, &entry->key);
+  if (previous != NULL) {
+    djvu_cache_unlink(cache, previous);
+    djvu_cache_entry_free(cache, previous);
+  }
+
+  g_hash_table_insert(cache->entries, &entry->key, entry);
+  g_queue_push_head_link(&cache->lru, &entry->link);
+  cache->size += size;
+
+  djvu_cache_evict(cache, cache->max_size);
+
+  g_mutex_unlock(&cache->lock);
+}
+
+void* djvu_cache_take(djvu_cache_t* cache, uint64_t key) {
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  gint64 lookup_key = key;
+  void* value       = NULL;
+
+  g_mutex_lock(&cache->lock);
+
+  djvu_cache_entry_t* entry = g_hash_table_lookup(cache->entries, &lookup_key);
+  if (entry != NULL) {
+    value = entry->value;
+    djvu_cache_unlink(cache, entry);
+    free(entry);
+  }
+
+  g_mutex_unlock(&cache->lock);
+
+  return value;
+}
+
+bool djvu_cache_contains(djvu_cache_t* cache, uint64_t key) {
+  if (cache == NULL) {
+    return false;
+  }
+
+  gint64 lookup_key = key;
+
+  g_mutex_lock(&cache->lock);
+  const bool contains = g_hash_table_contains(cache->entries, &lookup_key);
+  g_mutex_unlock(&cache->lock);
+
+  return contains;
+}
+
+void djvu_cache_remove(djvu_cache_t* cache, uint64_t key) {
+  void* value = djvu_cache_take(cache, key);
+  if (value != NULL && cache->free_function != NULL) {
+    cache->free_function(value);
+  }
+}
+
+void djvu_cache_remove_if(djvu_cache_t* cache, djvu_cache_predicate_t predicate, void* data) {
+  if (cache == NULL || predicate == NULL) {
+    return;
+  }
+
+  g_mutex_lock(&cache->lock);
+
+  GList* link = g_queue_peek_head_link(&cache->lru);
+  while (link != NULL) {
+    djvu_cache_entry_t* entry = link->data;
+    link                      = link->next;
+
+    if (predicate(entry->key, entry->value, data) == true) {
+      djvu_cache_unlink(cache, entry);
+      djvu_cache_entry_free(cache, entry);
+    }
+  }
+
+  g_mutex_unlock(&cache->lock);
+}
+
+void djvu_cache_clear(djvu_cache_t* cache) {
+  if (cache == NULL) {
+    return;
+  }
+
+  g_mutex_lock(&cache->lock);
+  djvu_cache_evict(cache, 0);
+  g_mutex_unlock(&cache->lock);
+}
+
+void djvu_cache_shrink(djvu_cache_t* cache, size_t size) {
+  if (cache == NULL) {
+    return;
+  }
+
+  g_mutex_lock(&cache->lock);
+  djvu_cache_evict(cache, size);
+  g_mutex_unlock(&cache->lock);
+}
+
+size_t djvu_cache_get_size(djvu_cache_t* cache) {
+  if (cache == NULL) {
+    return 0;
+  }
+
+  g_mutex_lock(&cache->lock);
+  const size_t size = cache->size;
+  g_mutex_unlock(&cache->lock);
+
+  return size;
+}
+
+size_t djvu_cache_get_max_size(djvu_cache_t* cache) {
+  if (cache == NULL) {
+    return 0;
+  }
+
+  g_mutex_lock(&cache->lock);
+  const size_t max_size = cache->max_size;
+  g_mutex_unlock(&cache->lock);
+
+  return max_size;
+}
+
+void djvu_cache_set_max_size(djvu_cache_t* cache, size_t max_size) {
+  if (cache == NULL) {
+    return;
+  }
+
+  g_mutex_lock(&cache->lock);
+  cache->max_size = max_size;
+  djvu_cache_evict(cache, max_size);
+  g_mutex_unlock(&cache->lock);
+}
+
+static void djvu_cache_unlink(djvu_cache_t* cache, djvu_cache_entry_t* entry) {
+  g_hash_table_remove(cache->entries, &entry->key);
+  g_queue_unlink(&cache->lru, &entry->link);
+  cache->size -= entry->size;
+}
+
+static void djvu_cache_entry_free(djvu_cache_t* cache, djvu_cache_entry_t* entry) {
+  if (cache->free_function != NULL) {
+    cache->free_function(entry->value);
+  }
+
+  free(entry);
+}
+
+static void djvu_cache_evict(djvu_cache_t* cache, size_t max_size) {
+  while (cache->size > max_size || (max_size == 0 && cache->lru.length > 0)) {
+    GList* link = g_queue_peek_tail_link(&cache->lru);
+    if (link == NULL) {
+      break;
+    }
+
+    djvu_cache_entry_t* entry = link->data;
+    djvu_cache_unlink(cache, entry);
+    djvu_cache_entry_free(cache, entry);
+  }
+}
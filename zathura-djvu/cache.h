@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_CACHE_H
+#define DJVU_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <glib.h>
+
+/**
+ * Size bounded least-recently-used cache
+ *
+ * Entries are owned by the cache until they are taken out again with
+ * djvu_cache_take. All functions are thread safe.
+ */
+typedef struct djvu_cache_s djvu_cache_t;
+
+/**
+ * Predicate for djvu_cache_remove_if
+ *
+ * @param key The key of the entry
+ * @param value The value of the entry
+ * @param data Custom data
+ * @return true if the entry should be removed
+ */
+typedef bool (*djvu_cache_predicate_t)(uint64_t key, void* value, void* data);
+
+/**
+ * Creates a new cache
+ *
+ * @param max_size Maximum accumulated size of all entries in bytes
+ * @param free_function Function used to free evicted entries
+ * @return The cache or NULL if an error occurred
+ */
+djvu_cache_t* djvu_cache_new(size_t max_size, GDestroyNotify free_function);
+
+/**
+ * Frees the cache and all of its entries
+ *
+ * @param cache The cache
+ */
+void djvu_cache_free(djvu_cache_t* cache);
+
+/**
+ * Inserts an entry into the cache. An existing entry with the same key is
+ * replaced and least recently used entries are evicted until the cache fits
+ * into its size limit again.
+ *
+ * @param cache The cache
+ * @param key The key
+ * @param value The value
+ * @param size Size of the value in bytes
+ */
+void djvu_cache_insert(djvu_cache_t* cache, uint64_t key, void* value, size_t size);
+
+/**
+ * Removes an entry from the cache and passes its ownership to the caller
+ *
+ * @param cache The cache
+ * @param key The key
+ * @return The value or NULL if the cache contains no entry for the key
+ */
+void* djvu_cache_take(djvu_cache_t* cache, uint64_t key);
+
+/**
+ * Checks if the cache contains an entry for the key
+ *
+ * @param cache The cache
+ * @param key The key
+ * @return true if an entry exists, otherwise false
+ */
+bool djvu_cache_contains(djvu_cache_t* cache, uint64_t key);
+
+/**
+ * Removes and frees an entry
+ *
+ * @param cache The cache
+ * @param key The key
+ */
+void djvu_cache_remove(djvu_cache_t* cache, uint64_t key);
+
+/**
+ * Removes and frees all entries matching a predicate. The predicate is called
+ * with the lock of the cache held.
+ *
+ * @param cache The cache
+ * @param predicate The predicate
+ * @param data Custom data passed to the predicate
+ */
+void djvu_cache_remove_if(djvu_cache_t* cache, djvu_cache_predicate_t predicate, void* data);
+
+/**
+ * Removes and frees all entries
+ *
+ * @param cache The cache
+ */
+void djvu_cache_clear(djvu_cache_t* cache);
+
+/**
+ * Evicts least recently used entries until the cache holds at most the given
+ * number of bytes. The size limit of the cache is not changed.
+ *
+ * @param cache The cache
+ * @param size Size in bytes
+ */
+void djvu_cache_shrink(djvu_cache_t* cache, size_t size);
+
+/**
+ * Returns the accumulated size of all entries
+ *
+ * @param cache The cache
+ * @return Size in bytes
+ */
+size_t djvu_cache_get_size(djvu_cache_t* cache);
+
+/**
+ * Returns the size limit of the cache
+ *
+ * @param cache The cache
+ * @return Size in bytes
+ */
+size_t djvu_cache_get_max_size(djvu_cache_t* cache);
+
+/**
+ * Changes the size limit of the cache. Least recently used entries are
+ * evicted until the cache fits into the new limit.
+ *
+ * @param cache The cache
+ * @param max_size Maximum accumulated size of all entries in bytes
+ */
+void djvu_cache_set_max_size(djvu_cache_t* cache, size_t max_size);
+
+#endif // DJVU_CACHE_H
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "config.h"
+
+unsigned long djvu_config_get_ulong(const char* name, unsigned long fallback) {
+  const char* value = g_getenv(name);
+  if (value == NULL || value[0] == '\0') {
+    return fallback;
+  }
+
+  char* end                  = NULL;
+  const guint64 parsed_value = g_ascii_strtoull(value, &end, 10);
+  if (end == value || *end != '\0') {
+    return fallback;
+  }
+
+  return parsed_value;
+}
+
+bool djvu_config_get_bool(const char* name, bool fallback) {
+  const char* value = g_getenv(name);
+  if (value == NULL) {
+    return fallback;
+  }
+
+  static const char* const enabled[]  = {"1", "true", "yes", "on"};
+  static const char* const disabled[] = {"0", "false", "no", "off"};
+
+  for (size_t i = 0; i < G_N_ELEMENTS(enabled); i++) {
+    if (g_ascii_strcasecmp(value, enabled[i]) == 0) {
+      return true;
+    }
+    if (g_ascii_strcasecmp(value, disabled[i]) == 0) {
+      return false;
+    }
+  }
+
+  return fallback;
+}
+
+char** djvu_config_get_argv(const char* name) {
+  const char* value = g_getenv(name);
+  if (value == NULL || value[0] == '\0') {
+    return NULL;
+  }
+
+  char** argv = NULL;
+  if (g_shell_parse_argv(value, NULL, &argv, NULL) == FALSE) {
+    return NULL;
+  }
+
+  return argv;
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_CONFIG_H
+#define DJVU_CONFIG_H
+
+#include <stdbool.h>
+
+/**
+ * Reads an unsigned integer setting from the environment
+ *
+ * @param name Name of the environment variable
+ * @param fallback Value used if the variable is not set or invalid
+ * @return The value of the setting
+ */
+unsigned long djvu_config_get_ulong(const char* name, unsigned long fallback);
+
+/**
+ * Reads a boolean setting from the environment. "1", "true", "yes" and "on"
+ * enable the setting, "0", "false", "no" and "off" disable it.
+ *
+ * @param name Name of the environment variable
+ * @param fallback Value used if the variable is not set or invalid
+ * @return The value of the setting
+ */
+bool djvu_config_get_bool(const char* name, bool fallback);
+
+/**
+ * Reads a list of arguments from the environment. The value is split like a
+ * shell command line.
+ *
+ * @param name Name of the environment variable
+ * @return NULL terminated list of arguments (needs to be deallocated with
+ *   g_strfreev) or NULL if the variable is not set or invalid
+ */
+char** djvu_config_get_argv(const char* name);
+
+#endif // DJVU_CONFIG_H
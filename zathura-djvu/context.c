@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <girara/macros.h>
+
+#include "context.h"
+#include "config.h"
+
+static GMutex shared_lock;
+static djvu_context_t* shared_context = NULL;
+
+/* forward declarations */
+static djvu_context_t* context_new(size_t cache_size);
+static void context_free(djvu_context_t* context);
+static void message_posted(ddjvu_context_t* context, void* data);
+
+djvu_context_t* djvu_context_acquire(size_t cache_size) {
+  if (djvu_config_get_bool("ZATHURA_DJVU_SHARED_CONTEXT", false) == false) {
+    djvu_context_t* context = context_new(cache_size);
+    if (context != NULL) {
+      context->references = 1;
+    }
+
+    return context;
+  }
+
+  /* the cache size is adjusted to the open documents by djvu_memory_register */
+  g_mutex_lock(&shared_lock);
+  if (shared_context == NULL) {
+    shared_context = context_new(cache_size);
+  }
+
+  djvu_context_t* context = shared_context;
+  if (context != NULL) {
+    context->references++;
+  }
+  g_mutex_unlock(&shared_lock);
+
+  return context;
+}
+
+void djvu_context_release(djvu_context_t* context) {
+  if (context == NULL) {
+    return;
+  }
+
+  g_mutex_lock(&shared_lock);
+  const bool unused = --context->references == 0;
+  if (unused == true && context == shared_context) {
+    shared_context = NULL;
+  }
+  g_mutex_unlock(&shared_lock);
+
+  if (unused == true) {
+    context_free(context);
+  }
+}
+
+static djvu_context_t* context_new(size_t cache_size) {
+  djvu_context_t* context = calloc(1, sizeof(djvu_context_t));
+  if (context == NULL) {
+    return NULL;
+  }
+
+  context->context = ddjvu_context_create("zathura");
+  if (context->context == NULL) {
+    free(context);
+    return NULL;
+  }
+
+  ddjvu_cache_set_size(context->context, cache_size);
+
+  /* waiting threads are woken up whenever a message is posted */
+  g_mutex_init(&context->message_lock);
+  g_cond_init(&context->message_cond);
+  g_mutex_init(&context->dispatch_lock);
+  ddjvu_message_set_callback(context->context, message_posted, context);
+
+  return context;
+}
+
+static void context_free(djvu_context_t* context) {
+  ddjvu_message_set_callback(context->context, NULL, NULL);
+  ddjvu_context_release(context->context);
+  g_mutex_clear(&context->dispatch_lock);
+  g_cond_clear(&context->message_cond);
+  g_mutex_clear(&context->message_lock);
+  free(context);
+}
+
+static void message_posted(ddjvu_context_t* UNUSED(context), void* data) {
+  djvu_context_t* djvu_context = data;
+
+  /* called by libdjvu from arbitrary threads, so no ddjvuapi calls here */
+  g_mutex_lock(&djvu_context->message_lock);
+  djvu_context->message_serial++;
+  g_cond_broadcast(&djvu_context->message_cond);
+  g_mutex_unlock(&djvu_context->message_lock);
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_CONTEXT_H
+#define DJVU_CONTEXT_H
+
+#include <stddef.h>
+#include <glib.h>
+#include <libdjvu/ddjvuapi.h>
+
+/**
+ * Decoder context together with the state needed to wait for and dispatch
+ * its messages
+ */
+typedef struct djvu_context_s {
+  ddjvu_context_t* context; /**< Decoder context */
+  unsigned int references;  /**< Number of documents using the context */
+
+  GMutex message_lock;    /**< Lock for message_serial */
+  GCond message_cond;     /**< Signalled when a message is posted */
+  guint64 message_serial; /**< Number of messages posted to the context */
+
+  GMutex dispatch_lock; /**< Serialises message dispatch and document creation */
+} djvu_context_t;
+
+/**
+ * Returns a decoder context for a new document. If ZATHURA_DJVU_SHARED_CONTEXT
+ * is enabled, all documents of the process share one context and one decoder
+ * cache. Otherwise every document gets a context of its own.
+ *
+ * @param cache_size Size of the decoder cache of a new context in bytes
+ * @return The context or NULL if an error occurred
+ */
+djvu_context_t* djvu_context_acquire(size_t cache_size);
+
+/**
+ * Releases a context returned by djvu_context_acquire. The context is freed
+ * once it is no longer used by any document.
+ *
+ * @param context The context
+ */
+void djvu_context_release(djvu_context_t* context);
+
+#endif // DJVU_CONTEXT_H
@@ -1,22 +1,30 @@
 /* SPDX-License-Identifier: Zlib */
 
 #include <stdlib.h>
-#include <ctype.h>
 #include <girara/datastructures.h>
 #include <string.h>
 #include <libdjvu/miniexp.h>
 #include <glib.h>
+#include <girara/log.h>
 
 #include "djvu.h"
+#include "annotations.h"
+#include "document.h"
 #include "page-text.h"
+#include "thumbnail.h"
+#include "prefetch.h"
+#include "render.h"
+#include "memory.h"
+#include "export.h"
+#include "stats.h"
+#include "trace.h"
 #include "internal.h"
 
 /* forward declarations */
 static const char* get_extension(const char* path);
-static void build_index(djvu_document_t* djvu_document, miniexp_t expression, girara_tree_node_t* root);
-static bool exp_to_str(miniexp_t expression, const char** string);
-static bool exp_to_int(miniexp_t expression, int* integer);
-static bool exp_to_rect(miniexp_t expression, zathura_rectangle_t* rect);
+static void save_progress(int percent, void* data);
+static girara_tree_node_t* build_index(GArray* entries);
+static bool page_is_invisible(void* data);
 
 ZATHURA_PLUGIN_REGISTER_WITH_FUNCTIONS("djvu", VERSION_MAJOR, VERSION_MINOR, VERSION_REV,
                                        ZATHURA_PLUGIN_FUNCTIONS({
@@ -38,106 +46,30 @@ ZATHURA_PLUGIN_REGISTER_WITH_FUNCTIONS("djvu", VERSION_MAJOR, VERSION_MINOR, VER
                                        }))
 
 zathura_error_t djvu_document_open(zathura_document_t* document) {
-  zathura_error_t error = ZATHURA_ERROR_OK;
-
   if (document == NULL) {
-    error = ZATHURA_ERROR_INVALID_ARGUMENTS;
-    goto error_out;
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
   }
 
-  djvu_document_t* djvu_document = calloc(1, sizeof(djvu_document_t));
+  zathura_error_t error          = ZATHURA_ERROR_OK;
+  djvu_document_t* djvu_document = djvu_document_new(zathura_document_get_path(document), &error);
   if (djvu_document == NULL) {
-    error = ZATHURA_ERROR_OUT_OF_MEMORY;
-    goto error_out;
-  }
-
-  /* setup format */
-  unsigned int masks[4] = {
-      0x00FF0000,
-      0x0000FF00,
-      0x000000FF,
-      0xFF000000,
-  };
-
-  djvu_document->format = ddjvu_format_create(DDJVU_FORMAT_RGBMASK32, 4, masks);
-  if (djvu_document->format == NULL) {
-    error = ZATHURA_ERROR_UNKNOWN;
-    goto error_free;
-  }
-
-  ddjvu_format_set_row_order(djvu_document->format, TRUE);
-
-  /* setup context */
-  djvu_document->context = ddjvu_context_create("zathura");
-
-  if (djvu_document->context == NULL) {
-    error = ZATHURA_ERROR_UNKNOWN;
-    goto error_free;
-  }
-
-  /* setup document */
-  djvu_document->document =
-      ddjvu_document_create_by_filename(djvu_document->context, zathura_document_get_path(document), FALSE);
-
-  if (djvu_document->document == NULL) {
-    error = ZATHURA_ERROR_UNKNOWN;
-    goto error_free;
-  }
-
-  /* load document info */
-  ddjvu_message_t* msg;
-  ddjvu_message_wait(djvu_document->context);
-
-  while ((msg = ddjvu_message_peek(djvu_document->context)) && (msg->m_any.tag != DDJVU_DOCINFO)) {
-    if (msg->m_any.tag == DDJVU_ERROR) {
-      error = ZATHURA_ERROR_UNKNOWN;
-      goto error_free;
-    }
-
-    ddjvu_message_pop(djvu_document->context);
-  }
-
-  /* decoding error */
-  if (ddjvu_document_decoding_error(djvu_document->document)) {
-    handle_messages(djvu_document, true);
-    error = ZATHURA_ERROR_UNKNOWN;
-    goto error_free;
+    return error;
   }
 
   zathura_document_set_data(document, djvu_document);
   zathura_document_set_number_of_pages(document, ddjvu_document_get_pagenum(djvu_document->document));
 
-  return error;
-
-error_free:
-
-  if (djvu_document->format != NULL) {
-    ddjvu_format_release(djvu_document->format);
-  }
-
-  if (djvu_document->context != NULL) {
-    ddjvu_context_release(djvu_document->context);
-  }
-
-  free(djvu_document);
-
-error_out:
-
-  return error;
+  return ZATHURA_ERROR_OK;
 }
 
 zathura_error_t djvu_document_free(zathura_document_t* document, void* data) {
-  djvu_document_t* djvu_document = data;
   if (document == NULL) {
     return ZATHURA_ERROR_INVALID_ARGUMENTS;
   }
 
-  if (djvu_document != NULL) {
-    ddjvu_context_release(djvu_document->context);
-    ddjvu_document_release(djvu_document->document);
-    ddjvu_format_release(djvu_document->format);
-    free(djvu_document);
-  }
+  djvu_document_destroy(data);
+  djvu_stats_dump();
+  djvu_trace_write();
 
   return ZATHURA_ERROR_OK;
 }
@@ -151,24 +83,13 @@ girara_tree_node_t* djvu_document_index_generate(zathura_document_t* document, v
     return NULL;
   }
 
-  miniexp_t outline = miniexp_dummy;
-  while ((outline = ddjvu_document_get_outline(djvu_document->document)) == miniexp_dummy) {
-    handle_messages(djvu_document, true);
-  }
-
-  if (outline == miniexp_dummy) {
-    return NULL;
-  }
-
-  if (miniexp_consp(outline) == 0 || miniexp_car(outline) != miniexp_symbol("bookmarks")) {
-    ddjvu_miniexp_release(djvu_document->document, outline);
+  GArray* entries = djvu_document_get_outline(djvu_document);
+  if (entries == NULL) {
     return NULL;
   }
 
-  girara_tree_node_t* root = girara_node_new(zathura_index_element_new("ROOT"));
-  build_index(djvu_document, miniexp_cdr(outline), root);
-
-  ddjvu_miniexp_release(djvu_document->document, outline);
+  girara_tree_node_t* root = build_index(entries);
+  g_array_free(entries, TRUE);
 
   return root;
 }
@@ -179,26 +100,34 @@ zathura_error_t djvu_document_save_as(zathura_document_t* document, void* data,
     return ZATHURA_ERROR_INVALID_ARGUMENTS;
   }
 
-  FILE* fp = fopen(path, "w");
-  if (fp == NULL) {
-    return ZATHURA_ERROR_UNKNOWN;
-  }
-
   const char* extension = get_extension(path);
-
-  ddjvu_job_t* job = NULL;
-  if (extension != NULL && g_strcmp0(extension, "ps") == 0) {
-    job = ddjvu_document_print(djvu_document->document, fp, 0, NULL);
-  } else {
-    job = ddjvu_document_save(djvu_document->document, fp, 0, NULL);
-  }
-  while (ddjvu_job_done(job) != true) {
-    handle_messages(djvu_document, true);
+  if (extension != NULL && g_ascii_strcasecmp(extension, "png") == 0) {
+    return djvu_export_images(djvu_document, path, DJVU_EXPORT_PNG);
+  } else if (extension != NULL && (g_ascii_strcasecmp(extension, "ppm") == 0 ||
+                                   g_ascii_strcasecmp(extension, "pnm") == 0)) {
+    return djvu_export_images(djvu_document, path, DJVU_EXPORT_PNM);
+  } else if (extension != NULL && g_ascii_strcasecmp(extension, "txt") == 0) {
+    return djvu_export_text(djvu_document, path, DJVU_EXPORT_TEXT);
+  } else if (extension != NULL && g_ascii_strcasecmp(extension, "hocr") == 0) {
+    return djvu_export_text(djvu_document, path, DJVU_EXPORT_HOCR);
+  } else if (extension != NULL && g_ascii_strcasecmp(extension, "json") == 0) {
+    return djvu_export_text(djvu_document, path, DJVU_EXPORT_JSON);
+  }
+
+  const djvu_export_format_t format = (extension != NULL && g_strcmp0(extension, "ps") == 0)
+                                          ? DJVU_EXPORT_POSTSCRIPT
+                                          : DJVU_EXPORT_DJVU;
+
+  char** options        = djvu_export_get_options(format, path);
+  zathura_error_t error = ZATHURA_ERROR_OK;
+  djvu_export_t* export = djvu_export_start(djvu_document, path, format, (const char* const*)options, save_progress,
+                                            (void*)path, &error);
+  g_strfreev(options);
+  if (export == NULL) {
+    return error;
   }
 
-  fclose(fp);
-
-  return ZATHURA_ERROR_OK;
+  return djvu_export_finish(export);
 }
 
 zathura_error_t djvu_page_init(zathura_page_t* page) {
@@ -209,36 +138,60 @@ zathura_error_t djvu_page_init(zathura_page_t* page) {
   zathura_document_t* document   = zathura_page_get_document(page);
   djvu_document_t* djvu_document = zathura_document_get_data(document);
 
-  ddjvu_status_t status;
-  ddjvu_pageinfo_t page_info;
-
-  unsigned int index = zathura_page_get_index(page);
-  while ((status = ddjvu_document_get_pageinfo(djvu_document->document, index, &page_info)) < DDJVU_JOB_OK) {
-    handle_messages(djvu_document, true);
+  djvu_geometry_t geometry;
+  zathura_error_t error = djvu_document_get_geometry(djvu_document, zathura_page_get_index(page), &geometry);
+  if (error != ZATHURA_ERROR_OK) {
+    return error;
   }
 
-  if (status >= DDJVU_JOB_FAILED) {
-    handle_messages(djvu_document, true);
-    return ZATHURA_ERROR_UNKNOWN;
+  djvu_page_t* djvu_page = calloc(1, sizeof(djvu_page_t));
+  if (djvu_page == NULL) {
+    return ZATHURA_ERROR_OUT_OF_MEMORY;
   }
 
-  zathura_page_set_width(page, ZATHURA_DJVU_SCALE * page_info.width);
-  zathura_page_set_height(page, ZATHURA_DJVU_SCALE * page_info.height);
+  g_mutex_init(&djvu_page->lock);
+  djvu_page->geometry = geometry;
+
+  zathura_page_set_width(page, djvu_geometry_get_width(&djvu_page->geometry));
+  zathura_page_set_height(page, djvu_geometry_get_height(&djvu_page->geometry));
+  zathura_page_set_data(page, djvu_page);
 
   return ZATHURA_ERROR_OK;
 }
 
-zathura_error_t djvu_page_clear(zathura_page_t* page, void* UNUSED(data)) {
+zathura_error_t djvu_page_clear(zathura_page_t* page, void* data) {
   if (page == NULL) {
     return ZATHURA_ERROR_INVALID_ARGUMENTS;
   }
 
+  djvu_page_t* djvu_page = data;
+  if (djvu_page == NULL) {
+    return ZATHURA_ERROR_OK;
+  }
+
+  zathura_document_t* document   = zathura_page_get_document(page);
+  djvu_document_t* djvu_document = (document != NULL) ? zathura_document_get_data(document) : NULL;
+
+  if (djvu_document != NULL) {
+    const unsigned int index = zathura_page_get_index(page);
+    djvu_cache_remove(djvu_document->pages, index);
+    djvu_cache_remove(djvu_document->thumbnails, index);
+    djvu_render_forget(djvu_document, index);
+    djvu_cache_remove(djvu_document->texts, index);
+    djvu_cache_remove(djvu_document->annotations, index);
+  }
+
+  g_mutex_clear(&djvu_page->lock);
+  free(djvu_page);
+
+  zathura_page_set_data(page, NULL);
+
   return ZATHURA_ERROR_OK;
 }
 
-girara_list_t* djvu_page_search_text(zathura_page_t* page, void* UNUSED(data), const char* text,
-                                     zathura_error_t* error) {
-  if (page == NULL || text == NULL || strlen(text) == 0) {
+girara_list_t* djvu_page_search_text(zathura_page_t* page, void* data, const char* text, zathura_error_t* error) {
+  djvu_page_t* djvu_page = data;
+  if (page == NULL || djvu_page == NULL || text == NULL || strlen(text) == 0) {
     if (error != NULL) {
       *error = ZATHURA_ERROR_INVALID_ARGUMENTS;
     }
@@ -252,26 +205,25 @@ girara_list_t* djvu_page_search_text(zathura_page_t* page, void* UNUSED(data), c
 
   djvu_document_t* djvu_document = zathura_document_get_data(document);
 
-  djvu_page_text_t* page_text = djvu_page_text_new(djvu_document, page);
-  if (page_text == NULL) {
-    goto error_ret;
+  g_mutex_lock(&djvu_page->lock);
+
+  girara_list_t* results      = NULL;
+  djvu_page_text_t* page_text = djvu_page_text_take(djvu_document, zathura_page_get_index(page));
+  if (page_text != NULL) {
+    const gint64 start = djvu_stats_begin();
+    results            = djvu_page_text_search(page_text, text);
+    djvu_stats_end(DJVU_STATS_SEARCH, start);
+    djvu_page_text_return(djvu_document, page_text);
   }
 
-  girara_list_t* results = djvu_page_text_search(page_text, text);
+  g_mutex_unlock(&djvu_page->lock);
+
   if (results == NULL) {
-    goto error_free;
+    goto error_ret;
   }
 
-  djvu_page_text_free(page_text);
-
   return results;
 
-error_free:
-
-  if (page_text != NULL) {
-    djvu_page_text_free(page_text);
-  }
-
 error_ret:
 
   if (error != NULL && *error == ZATHURA_ERROR_OK) {
@@ -281,9 +233,9 @@ error_ret:
   return NULL;
 }
 
-char* djvu_page_get_text(zathura_page_t* page, void* UNUSED(data), zathura_rectangle_t rectangle,
-                         zathura_error_t* error) {
-  if (page == NULL) {
+char* djvu_page_get_text(zathura_page_t* page, void* data, zathura_rectangle_t rectangle, zathura_error_t* error) {
+  djvu_page_t* djvu_page = data;
+  if (page == NULL || djvu_page == NULL) {
     if (error != NULL) {
       *error = ZATHURA_ERROR_INVALID_ARGUMENTS;
     }
@@ -297,54 +249,25 @@ char* djvu_page_get_text(zathura_page_t* page, void* UNUSED(data), zathura_recta
 
   djvu_document_t* djvu_document = zathura_document_get_data(document);
 
-  djvu_page_text_t* page_text = djvu_page_text_new(djvu_document, page);
+  djvu_geometry_view_to_text(&djvu_page->geometry, zathura_document_get_rotation(document), &rectangle);
+
+  g_mutex_lock(&djvu_page->lock);
+
+  char* text                  = NULL;
+  djvu_page_text_t* page_text = djvu_page_text_take(djvu_document, zathura_page_get_index(page));
+  if (page_text != NULL) {
+    const gint64 start = djvu_stats_begin();
+    text               = djvu_page_text_select(page_text, rectangle);
+    djvu_stats_end(DJVU_STATS_SELECTION, start);
+    djvu_page_text_return(djvu_document, page_text);
+  }
+
+  g_mutex_unlock(&djvu_page->lock);
+
   if (page_text == NULL) {
     goto error_ret;
   }
 
-  double tmp         = 0;
-  double page_height = zathura_page_get_height(page);
-  double page_width  = zathura_page_get_width(page);
-
-  switch (zathura_document_get_rotation(document)) {
-  case 90:
-    tmp          = rectangle.x1;
-    rectangle.x1 = rectangle.y1;
-    rectangle.y1 = tmp;
-    tmp          = rectangle.x2;
-    rectangle.x2 = rectangle.y2;
-    rectangle.y2 = tmp;
-    break;
-  case 180:
-    tmp          = rectangle.x1;
-    rectangle.x1 = (page_width - rectangle.x2);
-    rectangle.x2 = (page_width - tmp);
-    break;
-  case 270:
-    tmp          = rectangle.y2;
-    rectangle.y2 = (page_height - rectangle.x1);
-    rectangle.x1 = (page_width - tmp);
-    tmp          = rectangle.y1;
-    rectangle.y1 = (page_height - rectangle.x2);
-    rectangle.x2 = (page_width - tmp);
-    break;
-  default:
-    tmp          = rectangle.y1;
-    rectangle.y1 = (page_height - rectangle.y2);
-    rectangle.y2 = (page_height - tmp);
-    break;
-  }
-
-  /* adjust to scale */
-  rectangle.x1 /= ZATHURA_DJVU_SCALE;
-  rectangle.x2 /= ZATHURA_DJVU_SCALE;
-  rectangle.y1 /= ZATHURA_DJVU_SCALE;
-  rectangle.y2 /= ZATHURA_DJVU_SCALE;
-
-  char* text = djvu_page_text_select(page_text, rectangle);
-
-  djvu_page_text_free(page_text);
-
   return text;
 
 error_ret:
@@ -356,31 +279,73 @@ error_ret:
   return NULL;
 }
 
-girara_list_t* djvu_page_get_selection(zathura_page_t* UNUSED(page), void* UNUSED(data), zathura_rectangle_t rectangle,
+girara_list_t* djvu_page_get_selection(zathura_page_t* page, void* data, zathura_rectangle_t rectangle,
                                        zathura_error_t* error) {
-  girara_list_t* list = girara_list_new_with_free(g_free);
-  if (list == NULL) {
+  djvu_page_t* djvu_page = data;
+  if (page == NULL || djvu_page == NULL) {
     if (error != NULL) {
-      *error = ZATHURA_ERROR_OUT_OF_MEMORY;
+      *error = ZATHURA_ERROR_INVALID_ARGUMENTS;
     }
-    goto error_free;
+    goto error_ret;
   }
 
-  zathura_rectangle_t* rect = g_malloc0(sizeof(zathura_rectangle_t));
-  *rect                     = rectangle;
-  girara_list_append(list, rect);
+  zathura_document_t* document = zathura_page_get_document(page);
+  if (document == NULL) {
+    goto error_ret;
+  }
 
-  return list;
+  djvu_document_t* djvu_document = zathura_document_get_data(document);
+
+  zathura_rectangle_t selection = rectangle;
+  djvu_geometry_view_to_text(&djvu_page->geometry, zathura_document_get_rotation(document), &selection);
+
+  g_mutex_lock(&djvu_page->lock);
+
+  girara_list_t* list         = NULL;
+  djvu_page_text_t* page_text = djvu_page_text_take(djvu_document, zathura_page_get_index(page));
+  if (page_text != NULL) {
+    const gint64 start = djvu_stats_begin();
+    list               = djvu_page_text_select_lines(page_text, selection);
+    djvu_stats_end(DJVU_STATS_SELECTION, start);
+    djvu_page_text_return(djvu_document, page_text);
+  }
+
+  g_mutex_unlock(&djvu_page->lock);
 
-error_free:
   if (list != NULL) {
-    girara_list_free(list);
+    djvu_geometry_list_to_page(&djvu_page->geometry, list);
+    return list;
   }
+
+  /* pages without a text layer highlight the selected area itself */
+  if (page_text == NULL) {
+    list = girara_list_new_with_free(g_free);
+    if (list == NULL) {
+      if (error != NULL) {
+        *error = ZATHURA_ERROR_OUT_OF_MEMORY;
+      }
+      goto error_ret;
+    }
+
+    zathura_rectangle_t* rect = g_malloc0(sizeof(zathura_rectangle_t));
+    *rect                     = rectangle;
+    girara_list_append(list, rect);
+
+    return list;
+  }
+
+error_ret:
+
+  if (error != NULL && *error == ZATHURA_ERROR_OK) {
+    *error = ZATHURA_ERROR_UNKNOWN;
+  }
+
   return NULL;
 }
 
-girara_list_t* djvu_page_links_get(zathura_page_t* page, void* UNUSED(data), zathura_error_t* error) {
-  if (page == NULL) {
+girara_list_t* djvu_page_links_get(zathura_page_t* page, void* data, zathura_error_t* error) {
+  djvu_page_t* djvu_page = data;
+  if (page == NULL || djvu_page == NULL) {
     if (error != NULL) {
       *error = ZATHURA_ERROR_INVALID_ARGUMENTS;
     }
@@ -401,81 +366,48 @@ girara_list_t* djvu_page_links_get(zathura_page_t* page, void* UNUSED(data), zat
   }
 
   djvu_document_t* djvu_document = zathura_document_get_data(document);
+  const gint64 start             = djvu_stats_begin();
 
-  miniexp_t annotations = miniexp_nil;
-  while ((annotations = ddjvu_document_get_pageanno(djvu_document->document, zathura_page_get_index(page))) ==
-         miniexp_dummy) {
-    handle_messages(djvu_document, true);
-  }
+  g_mutex_lock(&djvu_page->lock);
 
-  if (annotations == miniexp_nil) {
+  djvu_annotations_t* annotations = djvu_annotations_take(djvu_document, zathura_page_get_index(page));
+  if (annotations == NULL) {
+    g_mutex_unlock(&djvu_page->lock);
     goto error_free;
   }
 
-  miniexp_t* hyperlinks = ddjvu_anno_get_hyperlinks(annotations);
-  for (miniexp_t* iter = hyperlinks; *iter != NULL; iter++) {
-    if (miniexp_car(*iter) != miniexp_symbol("maparea")) {
-      continue;
-    }
-
-    miniexp_t inner = miniexp_cdr(*iter);
-
-    /* extract url information */
-    const char* target_string = NULL;
-
-    if (miniexp_caar(inner) == miniexp_symbol("url")) {
-      if (exp_to_str(miniexp_caddr(miniexp_car(inner)), &target_string) == false) {
-        continue;
-      }
-    } else {
-      if (exp_to_str(miniexp_car(inner), &target_string) == false) {
-        continue;
-      }
-    }
+  const unsigned int number_of_pages = zathura_document_get_number_of_pages(document);
+  GArray* links                      = djvu_annotations_parse_links(annotations->annotations, number_of_pages);
 
-    /* skip comment */
-    inner = miniexp_cdr(inner);
+  for (guint i = 0; i < links->len; i++) {
+    const djvu_link_t* link = &g_array_index(links, djvu_link_t, i);
 
-    /* extract link area */
-    inner = miniexp_cdr(inner);
-
-    zathura_rectangle_t rect = {0, 0, 0, 0};
-    if (exp_to_rect(miniexp_car(inner), &rect) == false) {
-      continue;
-    }
-
-    /* update rect */
-    unsigned int page_height = zathura_page_get_height(page) / ZATHURA_DJVU_SCALE;
-    rect.x1                  = rect.x1 * ZATHURA_DJVU_SCALE;
-    rect.x2                  = rect.x2 * ZATHURA_DJVU_SCALE;
-    double tmp               = rect.y1;
-    rect.y1                  = (page_height - rect.y2) * ZATHURA_DJVU_SCALE;
-    rect.y2                  = (page_height - tmp) * ZATHURA_DJVU_SCALE;
+    zathura_rectangle_t rect = link->rectangle;
+    djvu_geometry_to_page(&djvu_page->geometry, &rect);
 
     /* create zathura link */
-    zathura_link_type_t type     = ZATHURA_LINK_INVALID;
+    zathura_link_type_t type     = ZATHURA_LINK_URI;
     zathura_link_target_t target = {ZATHURA_LINK_DESTINATION_UNKNOWN, NULL, 0, -1, -1, -1, -1, 0};
-    ;
 
-    /* goto page */
-    if (target_string[0] == '#' && target_string[1] == 'p') {
+    if (link->page >= 0) {
       type               = ZATHURA_LINK_GOTO_DEST;
-      target.page_number = atoi(target_string + 2) - 1;
-      /* url or other? */
-    } else if (strstr(target_string, "//") != NULL) {
-      type         = ZATHURA_LINK_URI;
-      target.value = (char*)target_string;
-      /* TODO: Parse all different links */
+      target.page_number = link->page;
     } else {
-      continue;
+      target.value = (char*)link->uri;
     }
 
-    zathura_link_t* link = zathura_link_new(type, rect, target);
-    if (link != NULL) {
-      girara_list_append(list, link);
+    zathura_link_t* zathura_link = zathura_link_new(type, rect, target);
+    if (zathura_link != NULL) {
+      girara_list_append(list, zathura_link);
     }
   }
 
+  g_array_free(links, TRUE);
+  djvu_annotations_return(djvu_document, annotations);
+  g_mutex_unlock(&djvu_page->lock);
+
+  djvu_stats_end(DJVU_STATS_LINKS, start);
+
   return list;
 
 error_free:
@@ -489,8 +421,7 @@ error_ret:
   return NULL;
 }
 
-zathura_error_t djvu_page_render_cairo(zathura_page_t* page, void* UNUSED(data), cairo_t* cairo,
-                                       bool GIRARA_UNUSED(printing)) {
+zathura_error_t djvu_page_render_cairo(zathura_page_t* page, void* UNUSED(data), cairo_t* cairo, bool printing) {
   if (page == NULL || cairo == NULL) {
     return ZATHURA_ERROR_INVALID_ARGUMENTS;
   }
@@ -500,44 +431,49 @@ zathura_error_t djvu_page_render_cairo(zathura_page_t* page, void* UNUSED(data),
     return ZATHURA_ERROR_UNKNOWN;
   }
 
-  /* init ddjvu render data */
-  djvu_document_t* djvu_document = zathura_document_get_data(document);
-  ddjvu_page_t* djvu_page        = ddjvu_page_create_by_pageno(djvu_document->document, zathura_page_get_index(page));
-
-  if (djvu_page == NULL) {
-    return ZATHURA_ERROR_UNKNOWN;
-  }
-
-  while (!ddjvu_page_decoding_done(djvu_page)) {
-    handle_messages(djvu_document, true);
-  }
-
   cairo_surface_t* surface = cairo_get_target(cairo);
 
   if (surface == NULL || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS ||
       cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
-    ddjvu_page_release(djvu_page);
     return ZATHURA_ERROR_UNKNOWN;
   }
 
-  unsigned int page_width  = cairo_image_surface_get_width(surface);
-  unsigned int page_height = cairo_image_surface_get_height(surface);
+  const unsigned int page_width  = cairo_image_surface_get_width(surface);
+  const unsigned int page_height = cairo_image_surface_get_height(surface);
 
-  ddjvu_rect_t rrect = {0, 0, page_width, page_height};
-  ddjvu_rect_t prect = {0, 0, page_width, page_height};
+  djvu_document_t* djvu_document = zathura_document_get_data(document);
 
-  char* surface_data = (char*)cairo_image_surface_get_data(surface);
+  /* thumbnails do not need a full render */
+  if (printing == false && page_width <= ZATHURA_DJVU_THUMBNAIL_SIZE && page_height <= ZATHURA_DJVU_THUMBNAIL_SIZE &&
+      djvu_thumbnail_render(djvu_document, zathura_page_get_index(page), surface) == true) {
+    return ZATHURA_ERROR_OK;
+  }
 
-  if (surface_data == NULL) {
-    ddjvu_page_release(djvu_page);
-    return ZATHURA_ERROR_UNKNOWN;
+  /* redraws and returns to an earlier zoom level reuse the last render */
+  const unsigned int index = zathura_page_get_index(page);
+  if (printing == false && djvu_render_from_cache(djvu_document, index, surface) == true) {
+    djvu_prefetch_schedule(djvu_document, index);
+    return ZATHURA_ERROR_OK;
   }
 
-  /* render page */
-  ddjvu_page_render(djvu_page, DDJVU_RENDER_COLOR, &prect, &rrect, djvu_document->format,
-                    cairo_image_surface_get_stride(surface), surface_data);
+  /* the visible page gets the decoder to itself */
+  if (printing == false) {
+    djvu_prefetch_cancel_stale(djvu_document, index);
+  }
+
+  /* zathura abandons renders of pages that were scrolled out of view */
+  zathura_error_t error = djvu_render_page(djvu_document, index, surface,
+                                           printing == false ? page_is_invisible : NULL, page);
+  if (error != ZATHURA_ERROR_OK) {
+    return error;
+  }
 
-  ddjvu_page_release(djvu_page);
+  if (printing == false) {
+    djvu_render_to_cache(djvu_document, index, surface);
+  }
+
+  djvu_prefetch_schedule(djvu_document, index);
+  djvu_memory_check();
 
   return ZATHURA_ERROR_OK;
 }
@@ -563,193 +499,52 @@ static const char* get_extension(const char* path) {
   return path + i + 1;
 }
 
-void handle_messages(djvu_document_t* document, bool wait) {
-  if (document == NULL || document->context == NULL) {
-    return;
-  }
-
-  ddjvu_context_t* context = document->context;
-  const ddjvu_message_t* message;
-
-  if (wait == true) {
-    ddjvu_message_wait(context);
-  }
-
-  while ((message = ddjvu_message_peek(context)) != NULL) {
-    ddjvu_message_pop(context);
-  }
+static void save_progress(int percent, void* data) {
+  girara_debug("djvu saving %s: %d%%", (const char*)data, percent);
 }
 
-static void build_index(djvu_document_t* djvu_document, miniexp_t expression, girara_tree_node_t* root) {
-  if (expression == miniexp_nil || root == NULL) {
-    return;
-  }
-
-  int fileno  = ddjvu_document_get_filenum(djvu_document->document);
-  int curfile = 0;
-
-  while (miniexp_consp(expression) != 0) {
-    miniexp_t inner = miniexp_car(expression);
-
-    if (miniexp_consp(inner) && miniexp_consp(miniexp_cdr(inner)) && miniexp_stringp(miniexp_car(inner)) &&
-        miniexp_stringp(miniexp_car(inner))) {
-      const char* name = miniexp_to_str(miniexp_car(inner));
-      const char* link = miniexp_to_str(miniexp_cadr(inner));
-
-      /* TODO: handle other links? */
-      if (link == NULL || link[0] != '#') {
-        expression = miniexp_cdr(expression);
-        continue;
-      }
-
-      zathura_link_type_t type     = ZATHURA_LINK_GOTO_DEST;
-      zathura_rectangle_t rect     = {0};
-      zathura_link_target_t target = {0};
-      target.destination_type      = ZATHURA_LINK_DESTINATION_XYZ;
-
-      /* Check if link+1 contains a number */
-      bool number          = true;
-      const size_t linklen = strlen(link);
-      for (unsigned int k = 1; k < linklen; k++) {
-        if (!isdigit(link[k])) {
-          number = false;
-          break;
-        }
-      }
-
-      /* if link starts with a number assume it is a number */
-      if (number == true) {
-        target.page_number = atoi(link + 1) - 1;
-      } else {
-        /* otherwise assume it is an id for a page */
-        ddjvu_fileinfo_t info;
-        int f, i;
-        for (i = 0; i < fileno; i++) {
-          f = (curfile + i) % fileno;
-          ddjvu_document_get_fileinfo(djvu_document->document, f, &info);
-          if (info.id != NULL && !strcmp(link + 1, info.id)) {
-            break;
-          }
-        }
-
-        /* got a page */
-        if (i < fileno && info.pageno >= 0) {
-          curfile            = (f + 1) % fileno;
-          target.page_number = info.pageno;
-        } else {
-          /* give up */
-          expression = miniexp_cdr(expression);
-          continue;
-        }
-      }
-
-      zathura_index_element_t* index_element = zathura_index_element_new(name);
-      if (index_element == NULL) {
-        continue;
-      }
-
-      index_element->link = zathura_link_new(type, rect, target);
-      if (index_element->link == NULL) {
-        zathura_index_element_free(index_element);
-        continue;
-      }
-
-      girara_tree_node_t* node = girara_node_append_data(root, index_element);
-
-      /* search recursive */
-      build_index(djvu_document, miniexp_cddr(inner), node);
-    }
-
-    expression = miniexp_cdr(expression);
-  }
+static bool page_is_invisible(void* data) {
+  return zathura_page_get_visibility(data) == false;
 }
 
-static bool exp_to_str(miniexp_t expression, const char** string) {
-  if (string == NULL) {
-    return false;
-  }
+static girara_tree_node_t* build_index(GArray* entries) {
+  girara_tree_node_t* root = girara_node_new(zathura_index_element_new("ROOT"));
 
-  if (miniexp_stringp(expression)) {
-    *string = miniexp_to_str(expression);
-    return true;
-  }
+  /* entries are listed in pre-order, so the last node of every level is the
+   * parent of the next entry one level down */
+  girara_tree_node_t* parents[ZATHURA_DJVU_MAX_OUTLINE_DEPTH + 1] = {root};
 
-  return false;
-}
+  unsigned int skipped = G_MAXUINT;
 
-static bool exp_to_int(miniexp_t expression, int* integer) {
-  if (integer == NULL) {
-    return false;
-  }
+  for (guint i = 0; i < entries->len; i++) {
+    const djvu_outline_entry_t* entry = &g_array_index(entries, djvu_outline_entry_t, i);
 
-  if (miniexp_numberp(expression)) {
-    *integer = miniexp_to_int(expression);
-    return true;
-  }
+    /* children of entries that could not be created are dropped as well */
+    if (entry->depth > skipped) {
+      continue;
+    }
+    skipped = G_MAXUINT;
 
-  return false;
-}
+    zathura_link_target_t target = {0};
+    target.destination_type      = ZATHURA_LINK_DESTINATION_XYZ;
+    target.page_number           = entry->page;
 
-static bool exp_to_rect(miniexp_t expression, zathura_rectangle_t* rect) {
-  if ((miniexp_car(expression) == miniexp_symbol("rect") || miniexp_car(expression) == miniexp_symbol("oval")) &&
-      miniexp_length(expression) == 5) {
-    int min_x  = 0;
-    int min_y  = 0;
-    int width  = 0;
-    int height = 0;
-
-    miniexp_t iter = miniexp_cdr(expression);
-    if (exp_to_int(miniexp_car(iter), &min_x) == false) {
-      return false;
-    }
-    iter = miniexp_cdr(iter);
-    if (exp_to_int(miniexp_car(iter), &min_y) == false) {
-      return false;
-    }
-    iter = miniexp_cdr(iter);
-    if (exp_to_int(miniexp_car(iter), &width) == false) {
-      return false;
-    }
-    iter = miniexp_cdr(iter);
-    if (exp_to_int(miniexp_car(iter), &height) == false) {
-      return false;
+    zathura_index_element_t* index_element = zathura_index_element_new(entry->title);
+    if (index_element == NULL) {
+      skipped = entry->depth;
+      continue;
     }
 
-    rect->x1 = min_x;
-    rect->x2 = min_x + width;
-    rect->y1 = min_y;
-    rect->y2 = min_y + height;
-  } else if (miniexp_car(expression) == miniexp_symbol("poly") && miniexp_length(expression) >= 5) {
-    int min_x = 0;
-    int min_y = 0;
-    int max_x = 0;
-    int max_y = 0;
-
-    miniexp_t iter = miniexp_cdr(expression);
-    while (iter != miniexp_nil) {
-      int x = 0;
-      int y = 0;
-
-      if (exp_to_int(miniexp_car(iter), &x) == false) {
-        return false;
-      }
-      iter = miniexp_cdr(iter);
-      if (exp_to_int(miniexp_car(iter), &y) == false) {
-        return false;
-      }
-      iter = miniexp_cdr(iter);
-
-      min_x = MIN(min_x, x);
-      min_y = MIN(min_y, y);
-      max_x = MAX(max_x, x);
-      max_y = MAX(max_y, y);
+    index_element->link = zathura_link_new(ZATHURA_LINK_GOTO_DEST, (zathura_rectangle_t){0}, target);
+    if (index_element->link == NULL) {
+      zathura_index_element_free(index_element);
+      skipped = entry->depth;
+      continue;
     }
 
-    rect->x1 = min_x;
-    rect->x2 = max_x;
-    rect->y1 = min_y;
-    rect->y2 = max_y;
+    parents[entry->depth + 1] = girara_node_append_data(parents[entry->depth], index_element);
   }
 
-  return true;
+  return root;
 }
+
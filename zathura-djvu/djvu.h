@@ -8,15 +8,49 @@
 #include <libdjvu/ddjvuapi.h>
 #include <cairo.h>
 
+#include "cache.h"
+#include "context.h"
+#include "geometry.h"
+
+/**
+ * How document data is supplied to libdjvu
+ */
+typedef enum djvu_stream_mode_e {
+  DJVU_STREAM_MODE_FILENAME,  /**< libdjvu reads the file itself */
+  DJVU_STREAM_MODE_STREAMING, /**< Data is written asynchronously by reader threads */
+} djvu_stream_mode_t;
+
 /**
  * DjVu document
  */
 typedef struct djvu_document_s {
+  djvu_context_t* decoder;    /**< Decoder context, possibly shared with other documents */
   ddjvu_context_t* context;   /**< Document context */
   ddjvu_document_t* document; /**< Document */
   ddjvu_format_t* format;     /**< Format */
+  djvu_cache_t* thumbnails;   /**< Thumbnail cache */
+  djvu_cache_t* pages;        /**< Decoded and prefetched pages */
+  djvu_cache_t* renders;      /**< Rendered pages by page and size */
+  djvu_cache_t* texts;        /**< Text layers of recently used pages */
+  djvu_cache_t* annotations;  /**< Annotations of recently used pages */
+
+  unsigned int prefetch_distance; /**< Number of pages to prefetch */
+  int last_rendered_page;         /**< Index of the last rendered page */
+  int page_type;                  /**< Type of the last decoded page, used to estimate page sizes */
+
+  djvu_stream_mode_t stream_mode; /**< How document data is supplied */
+  GThreadPool* stream_readers;    /**< Reader threads in streaming mode */
+  int streams_cancelled;          /**< Set when the readers have to stop */
 } djvu_document_t;
 
+/**
+ * DjVu page
+ */
+typedef struct djvu_page_s {
+  GMutex lock;              /**< Serializes the use of the text layer and annotations of the page */
+  djvu_geometry_t geometry; /**< Size, resolution and orientation */
+} djvu_page_t;
+
 /**
  * Open a DjVU document
  *
@@ -100,6 +134,15 @@ GIRARA_HIDDEN girara_list_t* djvu_page_search_text(zathura_page_t* page, void* d
 GIRARA_HIDDEN char* djvu_page_get_text(zathura_page_t* page, void* data, zathura_rectangle_t rectangle,
                                        zathura_error_t* error);
 
+/**
+ * Get the highlighted areas of a selection
+ *
+ * @param page Page
+ * @param rectangle Selection
+ * @error Set to an error value (see \ref zathura_error_t) if an error
+ * occurred
+ * @return One rectangle per selected line of text
+ */
 GIRARA_HIDDEN girara_list_t* djvu_page_get_selection(zathura_page_t* page, void* data, zathura_rectangle_t rectangle,
                                                      zathura_error_t* error);
 
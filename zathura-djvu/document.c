@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdlib.h>
+#include <glib.h>
+
+#include "document.h"
+#include "annotations.h"
+#include "context.h"
+#include "config.h"
+#include "memory.h"
+#include "page-text.h"
+#include "prefetch.h"
+#include "stream.h"
+#include "stats.h"
+#include "trace.h"
+#include "export.h"
+#include "internal.h"
+
+/* forward declarations */
+static void dispatch_message(const ddjvu_message_t* message);
+
+djvu_document_t* djvu_document_new(const char* path, zathura_error_t* error) {
+  zathura_error_t result = ZATHURA_ERROR_OK;
+
+  if (path == NULL) {
+    result = ZATHURA_ERROR_INVALID_ARGUMENTS;
+    goto error_out;
+  }
+
+  djvu_document_t* djvu_document = calloc(1, sizeof(djvu_document_t));
+  if (djvu_document == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_out;
+  }
+
+  /* setup format */
+  unsigned int masks[4] = {
+      0x00FF0000,
+      0x0000FF00,
+      0x000000FF,
+      0xFF000000,
+  };
+
+  djvu_document->format = ddjvu_format_create(DDJVU_FORMAT_RGBMASK32, 4, masks);
+  if (djvu_document->format == NULL) {
+    result = ZATHURA_ERROR_UNKNOWN;
+    goto error_free;
+  }
+
+  ddjvu_format_set_row_order(djvu_document->format, TRUE);
+
+  /* setup caches */
+  djvu_memory_budget_t budget;
+  djvu_memory_budget_get(&budget);
+
+  djvu_document->thumbnails = djvu_cache_new(budget.thumbnails, (GDestroyNotify)cairo_surface_destroy);
+  if (djvu_document->thumbnails == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_free;
+  }
+
+  djvu_document->pages = djvu_cache_new(budget.pages, (GDestroyNotify)djvu_prefetch_release);
+  if (djvu_document->pages == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_free;
+  }
+
+  djvu_document->renders = djvu_cache_new(budget.renders, (GDestroyNotify)cairo_surface_destroy);
+  if (djvu_document->renders == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_free;
+  }
+
+  djvu_document->texts = djvu_cache_new(budget.texts, (GDestroyNotify)djvu_page_text_free);
+  if (djvu_document->texts == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_free;
+  }
+
+  djvu_document->annotations = djvu_cache_new(budget.annotations, (GDestroyNotify)djvu_annotations_free);
+  if (djvu_document->annotations == NULL) {
+    result = ZATHURA_ERROR_OUT_OF_MEMORY;
+    goto error_free;
+  }
+
+  /* setup prefetching */
+  djvu_document->prefetch_distance  = djvu_config_get_ulong("ZATHURA_DJVU_PREFETCH", ZATHURA_DJVU_PREFETCH_DISTANCE);
+  djvu_document->last_rendered_page = -1;
+
+  /* setup context */
+  djvu_document->decoder = djvu_context_acquire(budget.decoder);
+
+  if (djvu_document->decoder == NULL) {
+    result = ZATHURA_ERROR_UNKNOWN;
+    goto error_free;
+  }
+
+  djvu_document->context = djvu_document->decoder->context;
+
+  /* setup document; messages are routed to their document by its user
+   * data, which has to be set before another thread can dispatch them */
+  g_mutex_lock(&djvu_document->decoder->dispatch_lock);
+  djvu_document->document = djvu_stream_create_document(djvu_document, path);
+  if (djvu_document->document != NULL) {
+    ddjvu_document_set_user_data(djvu_document->document, djvu_document);
+  }
+  g_mutex_unlock(&djvu_document->decoder->dispatch_lock);
+
+  if (djvu_document->document == NULL) {
+    result = ZATHURA_ERROR_UNKNOWN;
+    goto error_free;
+  }
+
+  /* load document info */
+  while (!ddjvu_document_decoding_done(djvu_document->document)) {
+    handle_messages(djvu_document, true);
+  }
+
+  /* decoding error */
+  if (ddjvu_document_decoding_error(djvu_document->document)) {
+    handle_messages(djvu_document, true);
+    result = ZATHURA_ERROR_UNKNOWN;
+    goto error_free;
+  }
+
+  djvu_memory_register(djvu_document);
+  djvu_stats_init();
+  djvu_trace_init();
+
+  return djvu_document;
+
+error_free:
+
+  if (djvu_document->format != NULL) {
+    ddjvu_format_release(djvu_document->format);
+  }
+
+  djvu_cache_free(djvu_document->thumbnails);
+  djvu_cache_free(djvu_document->renders);
+  djvu_cache_free(djvu_document->pages);
+  djvu_cache_free(djvu_document->texts);
+  djvu_cache_free(djvu_document->annotations);
+
+  djvu_stream_close(djvu_document);
+
+  if (djvu_document->document != NULL) {
+    g_mutex_lock(&djvu_document->decoder->dispatch_lock);
+    ddjvu_document_set_user_data(djvu_document->document, NULL);
+    g_mutex_unlock(&djvu_document->decoder->dispatch_lock);
+    ddjvu_document_release(djvu_document->document);
+  }
+
+  djvu_context_release(djvu_document->decoder);
+
+  free(djvu_document);
+
+error_out:
+
+  if (error != NULL) {
+    *error = result;
+  }
+
+  return NULL;
+}
+
+void djvu_document_destroy(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL) {
+    return;
+  }
+
+  djvu_memory_unregister(djvu_document);
+  djvu_memory_log_usage(djvu_document);
+
+  /* pages, expressions and streams have to be released before their document */
+  djvu_cache_free(djvu_document->pages);
+  djvu_cache_free(djvu_document->texts);
+  djvu_cache_free(djvu_document->annotations);
+  djvu_stream_close(djvu_document);
+
+  /* messages still queued in a shared context must not reach this document */
+  g_mutex_lock(&djvu_document->decoder->dispatch_lock);
+  ddjvu_document_set_user_data(djvu_document->document, NULL);
+  g_mutex_unlock(&djvu_document->decoder->dispatch_lock);
+
+  ddjvu_document_release(djvu_document->document);
+  djvu_context_release(djvu_document->decoder);
+  ddjvu_format_release(djvu_document->format);
+  djvu_cache_free(djvu_document->thumbnails);
+  djvu_cache_free(djvu_document->renders);
+  free(djvu_document);
+}
+
+zathura_error_t djvu_document_get_geometry(djvu_document_t* djvu_document, unsigned int index,
+                                           djvu_geometry_t* geometry) {
+  if (djvu_document == NULL || geometry == NULL) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  ddjvu_status_t status;
+  ddjvu_pageinfo_t page_info;
+  while ((status = ddjvu_document_get_pageinfo(djvu_document->document, index, &page_info)) < DDJVU_JOB_OK) {
+    handle_messages(djvu_document, true);
+  }
+
+  if (status >= DDJVU_JOB_FAILED) {
+    handle_messages(djvu_document, true);
+    return ZATHURA_ERROR_UNKNOWN;
+  }
+
+  djvu_geometry_init(geometry, &page_info);
+
+  return ZATHURA_ERROR_OK;
+}
+
+GArray* djvu_document_get_outline(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL) {
+    return NULL;
+  }
+
+  miniexp_t outline = miniexp_dummy;
+  while ((outline = ddjvu_document_get_outline(djvu_document->document)) == miniexp_dummy) {
+    handle_messages(djvu_document, true);
+  }
+
+  const gint64 start = djvu_stats_begin();
+  GArray* entries    = djvu_annotations_parse_outline(outline, djvu_document->document,
+                                                      ddjvu_document_get_pagenum(djvu_document->document));
+  djvu_stats_end(DJVU_STATS_OUTLINE, start);
+
+  ddjvu_miniexp_release(djvu_document->document, outline);
+
+  return entries;
+}
+
+void handle_messages(djvu_document_t* document, bool wait) {
+  if (document == NULL || document->decoder == NULL) {
+    return;
+  }
+
+  djvu_context_t* decoder  = document->decoder;
+  ddjvu_context_t* context = decoder->context;
+  const ddjvu_message_t* message;
+
+  /* ddjvu_message_wait blocks until the queue is non-empty, which never
+   * happens if another thread pops the message this thread is waiting for.
+   * Wait for the next message to be posted instead and bound the wait, since
+   * callers re-check the state of their job afterwards anyway. */
+  if (wait == true) {
+    g_mutex_lock(&decoder->message_lock);
+    const guint64 serial = decoder->message_serial;
+    g_mutex_unlock(&decoder->message_lock);
+
+    if (ddjvu_message_peek(context) == NULL) {
+      const gint64 end_time = g_get_monotonic_time() + ZATHURA_DJVU_MESSAGE_TIMEOUT;
+
+      g_mutex_lock(&decoder->message_lock);
+      while (serial == decoder->message_serial) {
+        if (g_cond_wait_until(&decoder->message_cond, &decoder->message_lock, end_time) == FALSE) {
+          break;
+        }
+      }
+      g_mutex_unlock(&decoder->message_lock);
+    }
+  }
+
+  /* every message has to be dispatched and popped exactly once, even if
+   * several threads handle the messages of the context */
+  g_mutex_lock(&decoder->dispatch_lock);
+  while ((message = ddjvu_message_peek(context)) != NULL) {
+    dispatch_message(message);
+    ddjvu_message_pop(context);
+  }
+  g_mutex_unlock(&decoder->dispatch_lock);
+}
+
+static void dispatch_message(const ddjvu_message_t* message) {
+  djvu_trace_page_message(message);
+
+  /* the message may belong to any document sharing the context */
+  djvu_document_t* document = NULL;
+  if (message->m_any.document != NULL) {
+    document = ddjvu_document_get_user_data(message->m_any.document);
+  }
+
+  switch (message->m_any.tag) {
+  case DDJVU_NEWSTREAM:
+    if (document != NULL) {
+      djvu_stream_handle_message(document, message);
+    } else {
+      /* the document is being closed */
+      ddjvu_stream_close(message->m_any.document, message->m_newstream.streamid, TRUE);
+    }
+    break;
+  case DDJVU_PROGRESS:
+    djvu_export_handle_message(message);
+    break;
+  default:
+    break;
+  }
+}
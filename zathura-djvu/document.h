@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_DOCUMENT_H
+#define DJVU_DOCUMENT_H
+
+#include <glib.h>
+
+#include "djvu.h"
+
+/**
+ * Opens a document and waits until its structure has been decoded. This does
+ * not depend on zathura and is shared by the plugin and the standalone
+ * tools.
+ *
+ * @param path Path of the document
+ * @param error Set to an error value (see zathura_error_t) if an error
+ *   occurred
+ * @return The document or NULL if an error occurred
+ */
+djvu_document_t* djvu_document_new(const char* path, zathura_error_t* error);
+
+/**
+ * Closes a document and frees all of its resources
+ *
+ * @param document The document
+ */
+void djvu_document_destroy(djvu_document_t* document);
+
+/**
+ * Waits for the size, resolution and orientation of a page
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param geometry Receives the geometry of the page
+ * @return ZATHURA_ERROR_OK if the page information could be decoded,
+ *   otherwise an error value (see zathura_error_t)
+ */
+zathura_error_t djvu_document_get_geometry(djvu_document_t* document, unsigned int index, djvu_geometry_t* geometry);
+
+/**
+ * Waits for the outline of a document and flattens it (see
+ * djvu_annotations_parse_outline)
+ *
+ * @param document The document
+ * @return Array of djvu_outline_entry_t (needs to be deallocated with
+ *   g_array_free) or NULL if the document has no outline
+ */
+GArray* djvu_document_get_outline(djvu_document_t* document);
+
+#endif // DJVU_DOCUMENT_H
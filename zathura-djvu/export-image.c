@@ -0,0 +1,253 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <girara/log.h>
+
+#include "export.h"
+#include "config.h"
+#include "internal.h"
+
+/* forward declarations */
+static bool write_png(djvu_document_t* djvu_document, ddjvu_page_t* djvu_page, unsigned int width,
+                      unsigned int height, const char* path);
+static bool write_pnm(ddjvu_page_t* djvu_page, unsigned int width, unsigned int height, ddjvu_format_t* format,
+                      FILE* fp);
+static char* png_path(const char* path, unsigned int index, unsigned int pagenum);
+
+GArray* djvu_export_get_pages(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL) {
+    return NULL;
+  }
+
+  const int pagenum = ddjvu_document_get_pagenum(djvu_document->document);
+  GArray* pages     = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+
+  const char* spec = g_getenv("ZATHURA_DJVU_PAGES");
+  if (spec == NULL || spec[0] == '\0') {
+    for (unsigned int i = 0; i < (unsigned int)pagenum; i++) {
+      g_array_append_val(pages, i);
+    }
+    return pages;
+  }
+
+  char** ranges = g_strsplit(spec, ",", -1);
+  for (char** iter = ranges; *iter != NULL; iter++) {
+    char* end         = NULL;
+    const char* range = g_strstrip(*iter);
+    guint64 first     = g_ascii_strtoull(range, &end, 10);
+    guint64 last      = first;
+
+    if (end == range) {
+      goto error_free;
+    }
+
+    if (*end == '-') {
+      const char* second = end + 1;
+      last               = g_ascii_strtoull(second, &end, 10);
+      if (end == second) {
+        goto error_free;
+      }
+    }
+
+    if (*end != '\0' || first < 1 || last < first || last > (guint64)pagenum) {
+      goto error_free;
+    }
+
+    for (unsigned int i = first - 1; i < last; i++) {
+      g_array_append_val(pages, i);
+    }
+  }
+
+  g_strfreev(ranges);
+
+  return pages;
+
+error_free:
+
+  g_strfreev(ranges);
+  g_array_free(pages, TRUE);
+
+  return NULL;
+}
+
+zathura_error_t djvu_export_images(djvu_document_t* djvu_document, const char* path, djvu_export_format_t format) {
+  if (djvu_document == NULL || path == NULL || (format != DJVU_EXPORT_PNG && format != DJVU_EXPORT_PNM)) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  GArray* pages = djvu_export_get_pages(djvu_document);
+  if (pages == NULL) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  zathura_error_t error   = ZATHURA_ERROR_OK;
+  const unsigned long dpi = MAX(1, djvu_config_get_ulong("ZATHURA_DJVU_EXPORT_DPI", ZATHURA_DJVU_EXPORT_DPI));
+  FILE* fp                = NULL;
+  ddjvu_format_t* rgb     = NULL;
+  GQueue window           = G_QUEUE_INIT;
+  unsigned int created    = 0;
+  GPtrArray* written      = g_ptr_array_new_with_free_func(g_free);
+
+  if (format == DJVU_EXPORT_PNM) {
+    fp  = fopen(path, "wb");
+    rgb = ddjvu_format_create(DDJVU_FORMAT_RGB24, 0, NULL);
+    if (fp == NULL || rgb == NULL) {
+      error = ZATHURA_ERROR_UNKNOWN;
+      goto error_free;
+    }
+
+    /* strips are rendered from the top of the page */
+    ddjvu_format_set_row_order(rgb, TRUE);
+    ddjvu_format_set_y_direction(rgb, TRUE);
+  }
+
+  for (unsigned int i = 0; i < pages->len; i++) {
+    /* keep the decoder busy with the following pages */
+    while (created < pages->len && created < i + ZATHURA_DJVU_EXPORT_WINDOW) {
+      const unsigned int next_index = g_array_index(pages, unsigned int, created++);
+      ddjvu_page_t* next_page       = ddjvu_page_create_by_pageno(djvu_document->document, next_index);
+      if (next_page == NULL) {
+        error = ZATHURA_ERROR_UNKNOWN;
+        goto error_free;
+      }
+
+      g_queue_push_tail(&window, next_page);
+    }
+
+    const unsigned int index = g_array_index(pages, unsigned int, i);
+    ddjvu_page_t* djvu_page  = g_queue_pop_head(&window);
+    if (djvu_page == NULL) {
+      error = ZATHURA_ERROR_UNKNOWN;
+      goto error_free;
+    }
+
+    while (!ddjvu_page_decoding_done(djvu_page)) {
+      handle_messages(djvu_document, true);
+    }
+
+    /* a broken page does not spoil the rest of the document */
+    if (ddjvu_page_decoding_error(djvu_page) == TRUE) {
+      girara_warning("djvu export: could not decode page %u, skipping it", index + 1);
+      ddjvu_page_release(djvu_page);
+      continue;
+    }
+
+    const int resolution      = MAX(1, ddjvu_page_get_resolution(djvu_page));
+    const unsigned int width  = MAX(1, (unsigned long)ddjvu_page_get_width(djvu_page) * dpi / resolution);
+    const unsigned int height = MAX(1, (unsigned long)ddjvu_page_get_height(djvu_page) * dpi / resolution);
+
+    bool result = false;
+    if (format == DJVU_EXPORT_PNM) {
+      result = write_pnm(djvu_page, width, height, rgb, fp);
+    } else {
+      char* page_path = png_path(path, index, pages->len);
+      result          = write_png(djvu_document, djvu_page, width, height, page_path);
+      g_ptr_array_add(written, page_path);
+    }
+
+    ddjvu_page_release(djvu_page);
+
+    if (result == false) {
+      error = ZATHURA_ERROR_UNKNOWN;
+      goto error_free;
+    }
+  }
+
+error_free:
+
+  for (ddjvu_page_t* djvu_page = g_queue_pop_head(&window); djvu_page != NULL;
+       djvu_page               = g_queue_pop_head(&window)) {
+    ddjvu_page_release(djvu_page);
+  }
+
+  if (fp != NULL && fclose(fp) != 0) {
+    error = ZATHURA_ERROR_UNKNOWN;
+  }
+
+  if (fp != NULL && error != ZATHURA_ERROR_OK) {
+    g_unlink(path);
+  }
+
+  /* a failed export leaves no images of earlier pages behind */
+  for (guint i = 0; i < written->len && error != ZATHURA_ERROR_OK; i++) {
+    g_unlink(g_ptr_array_index(written, i));
+  }
+  g_ptr_array_unref(written);
+
+  if (rgb != NULL) {
+    ddjvu_format_release(rgb);
+  }
+
+  g_array_free(pages, TRUE);
+
+  return error;
+}
+
+static bool write_png(djvu_document_t* djvu_document, ddjvu_page_t* djvu_page, unsigned int width,
+                      unsigned int height, const char* path) {
+  cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    return false;
+  }
+
+  ddjvu_rect_t rect = {0, 0, width, height};
+
+  cairo_surface_flush(surface);
+  int rendered = ddjvu_page_render(djvu_page, DDJVU_RENDER_COLOR, &rect, &rect, djvu_document->format,
+                                   cairo_image_surface_get_stride(surface),
+                                   (char*)cairo_image_surface_get_data(surface));
+  cairo_surface_mark_dirty(surface);
+
+  const bool result = rendered != FALSE && cairo_surface_write_to_png(surface, path) == CAIRO_STATUS_SUCCESS;
+  cairo_surface_destroy(surface);
+
+  return result;
+}
+
+static bool write_pnm(ddjvu_page_t* djvu_page, unsigned int width, unsigned int height, ddjvu_format_t* format,
+                      FILE* fp) {
+  if (fprintf(fp, "P6\n%u %u\n255\n", width, height) < 0) {
+    return false;
+  }
+
+  const unsigned long rowsize = (unsigned long)width * 3;
+  char* strip                 = g_malloc(rowsize * MIN(height, ZATHURA_DJVU_EXPORT_STRIP_HEIGHT));
+
+  ddjvu_rect_t page_rect = {0, 0, width, height};
+  bool result            = true;
+
+  for (unsigned int y = 0; y < height && result == true; y += ZATHURA_DJVU_EXPORT_STRIP_HEIGHT) {
+    const unsigned int rows = MIN(height - y, ZATHURA_DJVU_EXPORT_STRIP_HEIGHT);
+    ddjvu_rect_t strip_rect = {0, y, width, rows};
+
+    if (ddjvu_page_render(djvu_page, DDJVU_RENDER_COLOR, &page_rect, &strip_rect, format, rowsize, strip) ==
+        FALSE) {
+      /* pages without image data are white */
+      memset(strip, 0xFF, rowsize * rows);
+    }
+
+    result = fwrite(strip, rowsize, rows, fp) == rows;
+  }
+
+  g_free(strip);
+
+  return result;
+}
+
+static char* png_path(const char* path, unsigned int index, unsigned int pagenum) {
+  if (pagenum == 1) {
+    return g_strdup(path);
+  }
+
+  const char* extension = strrchr(path, '.');
+  if (extension == NULL || strchr(extension, '/') != NULL) {
+    return g_strdup_printf("%s-%04u", path, index + 1);
+  }
+
+  return g_strdup_printf("%.*s-%04u%s", (int)(extension - path), path, index + 1, extension);
+}
@@ -0,0 +1,283 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libdjvu/miniexp.h>
+
+#include "export.h"
+#include "internal.h"
+
+/**
+ * State of a text export
+ */
+typedef struct text_writer_s {
+  FILE* fp;                    /**< Output file */
+  djvu_export_format_t format; /**< Output format */
+  int height;                  /**< Height of the current page */
+  unsigned int page;           /**< Number of the current page */
+  unsigned int line;           /**< Number of the current line on the page */
+  bool first_page;             /**< Nothing has been written yet */
+  bool first_word;             /**< No word has been written on the current page or line */
+} text_writer_t;
+
+/**
+ * Bounding box of a text layer element
+ */
+typedef struct text_box_s {
+  int x1; /**< Left */
+  int y1; /**< Top */
+  int x2; /**< Right */
+  int y2; /**< Bottom */
+} text_box_t;
+
+/* forward declarations */
+static bool exp_to_box(text_writer_t* writer, miniexp_t exp, text_box_t* box);
+static void write_page(text_writer_t* writer, miniexp_t exp);
+static void write_element(text_writer_t* writer, miniexp_t exp);
+static void write_word(text_writer_t* writer, const char* text, const text_box_t* box);
+static void write_json_string(FILE* fp, const char* text);
+static const char* hocr_class(miniexp_t type);
+
+zathura_error_t djvu_export_text(djvu_document_t* djvu_document, const char* path, djvu_export_format_t format) {
+  if (djvu_document == NULL || path == NULL ||
+      (format != DJVU_EXPORT_TEXT && format != DJVU_EXPORT_HOCR && format != DJVU_EXPORT_JSON)) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  GArray* pages = djvu_export_get_pages(djvu_document);
+  if (pages == NULL) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  text_writer_t writer = {0};
+  writer.format        = format;
+  writer.first_page    = true;
+
+  writer.fp = fopen(path, "w");
+  if (writer.fp == NULL) {
+    g_array_free(pages, TRUE);
+    return ZATHURA_ERROR_UNKNOWN;
+  }
+
+  if (format == DJVU_EXPORT_HOCR) {
+    fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.0 Transitional//EN\" "
+          "\"http://www.w3.org/TR/xhtml1/DTD/xhtml1-transitional.dtd\">\n"
+          "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+          "<head>\n<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\" />\n"
+          "<meta name=\"ocr-system\" content=\"zathura-djvu\" />\n"
+          "<meta name=\"ocr-capabilities\" content=\"ocr_page ocr_carea ocr_par ocr_line ocrx_word\" />\n"
+          "</head>\n<body>\n",
+          writer.fp);
+  } else if (format == DJVU_EXPORT_JSON) {
+    fputs("{\"pages\":[", writer.fp);
+  }
+
+  for (unsigned int i = 0; i < pages->len; i++) {
+    const unsigned int index = g_array_index(pages, unsigned int, i);
+
+    /* only one page is held in memory at a time */
+    miniexp_t text = miniexp_nil;
+    while ((text = ddjvu_document_get_pagetext(djvu_document->document, index, "word")) == miniexp_dummy) {
+      handle_messages(djvu_document, true);
+    }
+
+    writer.page = index + 1;
+    write_page(&writer, text);
+
+    if (text != miniexp_nil) {
+      ddjvu_miniexp_release(djvu_document->document, text);
+    }
+  }
+
+  if (format == DJVU_EXPORT_HOCR) {
+    fputs("</body>\n</html>\n", writer.fp);
+  } else if (format == DJVU_EXPORT_JSON) {
+    fputs("]}\n", writer.fp);
+  }
+
+  zathura_error_t error = ZATHURA_ERROR_OK;
+  if (ferror(writer.fp) != 0) {
+    error = ZATHURA_ERROR_UNKNOWN;
+  }
+  if (fclose(writer.fp) != 0) {
+    error = ZATHURA_ERROR_UNKNOWN;
+  }
+  if (error != ZATHURA_ERROR_OK) {
+    g_unlink(path);
+  }
+
+  g_array_free(pages, TRUE);
+
+  return error;
+}
+
+static bool exp_to_box(text_writer_t* writer, miniexp_t exp, text_box_t* box) {
+  if (miniexp_consp(exp) == 0 || miniexp_symbolp(miniexp_car(exp)) == 0) {
+    return false;
+  }
+
+  int coordinates[4];
+  miniexp_t iter = miniexp_cdr(exp);
+  for (unsigned int i = 0; i < 4; i++) {
+    if (miniexp_numberp(miniexp_car(iter)) == 0) {
+      return false;
+    }
+
+    coordinates[i] = miniexp_to_int(miniexp_car(iter));
+    iter           = miniexp_cdr(iter);
+  }
+
+  /* flip to a top left origin */
+  box->x1 = coordinates[0];
+  box->x2 = coordinates[2];
+  box->y1 = writer->height - coordinates[3];
+  box->y2 = writer->height - coordinates[1];
+
+  return true;
+}
+
+static void write_page(text_writer_t* writer, miniexp_t exp) {
+  writer->height     = 0;
+  writer->line       = 0;
+  writer->first_word = true;
+
+  if (miniexp_consp(exp) != 0 && miniexp_numberp(miniexp_nth(4, exp)) != 0) {
+    writer->height = miniexp_to_int(miniexp_nth(4, exp));
+  }
+
+  text_box_t box = {0};
+  exp_to_box(writer, exp, &box);
+
+  switch (writer->format) {
+  case DJVU_EXPORT_HOCR:
+    fprintf(writer->fp, "<div class=\"ocr_page\" id=\"page_%u\" title=\"bbox %d %d %d %d; ppageno %u\">\n",
+            writer->page, box.x1, box.y1, box.x2, box.y2, writer->page - 1);
+    write_element(writer, exp);
+    fputs("</div>\n", writer->fp);
+    break;
+  case DJVU_EXPORT_JSON:
+    fprintf(writer->fp, "%s{\"page\":%u,\"width\":%d,\"height\":%d,\"words\":[", writer->first_page ? "" : ",",
+            writer->page, box.x2, writer->height);
+    write_element(writer, exp);
+    fputs("]}", writer->fp);
+    break;
+  default:
+    if (writer->first_page == false) {
+      fputc('\f', writer->fp);
+    }
+    write_element(writer, exp);
+    break;
+  }
+
+  writer->first_page = false;
+}
+
+static void write_element(text_writer_t* writer, miniexp_t exp) {
+  text_box_t box;
+  if (exp_to_box(writer, exp, &box) == false) {
+    return;
+  }
+
+  const miniexp_t type  = miniexp_car(exp);
+  const bool is_line    = type == miniexp_symbol("line");
+  const char* css_class = hocr_class(type);
+
+  if (writer->format == DJVU_EXPORT_HOCR && css_class != NULL) {
+    fprintf(writer->fp, "<%s class=\"%s\" title=\"bbox %d %d %d %d\">", is_line ? "span" : "div", css_class, box.x1,
+            box.y1, box.x2, box.y2);
+  }
+
+  for (miniexp_t iter = miniexp_cddr(miniexp_cdddr(exp)); miniexp_consp(iter) != 0; iter = miniexp_cdr(iter)) {
+    miniexp_t data = miniexp_car(iter);
+
+    if (miniexp_stringp(data) != 0) {
+      write_word(writer, miniexp_to_str(data), &box);
+    } else {
+      write_element(writer, data);
+    }
+  }
+
+  if (writer->format == DJVU_EXPORT_HOCR && css_class != NULL) {
+    fprintf(writer->fp, "</%s>\n", is_line ? "span" : "div");
+  }
+
+  if (is_line == true) {
+    if (writer->format == DJVU_EXPORT_TEXT) {
+      fputc('\n', writer->fp);
+      writer->first_word = true;
+    }
+    writer->line++;
+  }
+}
+
+static void write_word(text_writer_t* writer, const char* text, const text_box_t* box) {
+  if (text == NULL) {
+    return;
+  }
+
+  switch (writer->format) {
+  case DJVU_EXPORT_HOCR: {
+    char* escaped = g_markup_escape_text(text, -1);
+    fprintf(writer->fp, "<span class=\"ocrx_word\" title=\"bbox %d %d %d %d\">%s</span> ", box->x1, box->y1, box->x2,
+            box->y2, escaped);
+    g_free(escaped);
+    break;
+  }
+  case DJVU_EXPORT_JSON:
+    fprintf(writer->fp, "%s{\"line\":%u,\"bbox\":[%d,%d,%d,%d],\"text\":", writer->first_word ? "" : ",",
+            writer->line, box->x1, box->y1, box->x2, box->y2);
+    write_json_string(writer->fp, text);
+    fputc('}', writer->fp);
+    break;
+  default:
+    if (writer->first_word == false) {
+      fputc(' ', writer->fp);
+    }
+    fputs(text, writer->fp);
+    break;
+  }
+
+  writer->first_word = false;
+}
+
+static void write_json_string(FILE* fp, const char* text) {
+  fputc('"', fp);
+  for (const unsigned char* iter = (const unsigned char*)text; *iter != '\0'; iter++) {
+    switch (*iter) {
+    case '"':
+      fputs("\\\"", fp);
+      break;
+    case '\\':
+      fputs("\\\\", fp);
+      break;
+    case '\n':
+      fputs("\\n", fp);
+      break;
+    case '\t':
+      fputs("\\t", fp);
+      break;
+    default:
+      if (*iter < 0x20) {
+        fprintf(fp, "\\u%04x", *iter);
+      } else {
+        fputc(*iter, fp);
+      }
+      break;
+    }
+  }
+  fputc('"', fp);
+}
+
+static const char* hocr_class(miniexp_t type) {
+  if (type == miniexp_symbol("column") || type == miniexp_symbol("region")) {
+    return "ocr_carea";
+  } else if (type == miniexp_symbol("para")) {
+    return "ocr_par";
+  } else if (type == miniexp_symbol("line")) {
+    return "ocr_line";
+  }
+
+  return NULL;
+}
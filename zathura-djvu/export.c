@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "export.h"
+#include "config.h"
+#include "internal.h"
+
+struct djvu_export_s {
+  djvu_document_t* document;       /**< Document */
+  ddjvu_job_t* job;                /**< ddjvu save or print job */
+  FILE* fp;                        /**< Output file */
+  char* path;                      /**< Path of the output file */
+  djvu_export_progress_t progress; /**< Progress callback */
+  void* data;                      /**< Custom data of the progress callback */
+  bool cancelled;                  /**< Whether the job was cancelled */
+};
+
+char** djvu_export_get_options(djvu_export_format_t format, const char* path) {
+  GPtrArray* options = g_ptr_array_new();
+
+  /* saving in the native format is also how a document is copied, so it
+   * only drops pages if asked to separately */
+  const char* pages = g_getenv(format == DJVU_EXPORT_DJVU ? "ZATHURA_DJVU_SAVE_PAGES" : "ZATHURA_DJVU_PAGES");
+
+  /* print and save jobs spell the page option differently */
+  if (pages != NULL && pages[0] != '\0') {
+    g_ptr_array_add(options, g_strdup_printf("%s=%s", format == DJVU_EXPORT_POSTSCRIPT ? "-page" : "-pages", pages));
+  }
+
+  if (format == DJVU_EXPORT_DJVU && path != NULL && djvu_config_get_bool("ZATHURA_DJVU_INDIRECT", false) == true) {
+    g_ptr_array_add(options, g_strdup_printf("-indirect=%s", path));
+  }
+
+  if (format == DJVU_EXPORT_POSTSCRIPT) {
+    char** print_options = djvu_config_get_argv("ZATHURA_DJVU_PRINT_OPTIONS");
+    for (char** iter = print_options; iter != NULL && *iter != NULL; iter++) {
+      g_ptr_array_add(options, g_strdup(*iter));
+    }
+    g_strfreev(print_options);
+  }
+
+  g_ptr_array_add(options, NULL);
+
+  return (char**)g_ptr_array_free(options, FALSE);
+}
+
+djvu_export_t* djvu_export_start(djvu_document_t* djvu_document, const char* path, djvu_export_format_t format,
+                                 const char* const* options, djvu_export_progress_t progress, void* data,
+                                 zathura_error_t* error) {
+  if (djvu_document == NULL || path == NULL) {
+    if (error != NULL) {
+      *error = ZATHURA_ERROR_INVALID_ARGUMENTS;
+    }
+    return NULL;
+  }
+
+  djvu_export_t* export = calloc(1, sizeof(djvu_export_t));
+  if (export == NULL) {
+    if (error != NULL) {
+      *error = ZATHURA_ERROR_OUT_OF_MEMORY;
+    }
+    return NULL;
+  }
+
+  export->document = djvu_document;
+  export->path     = g_strdup(path);
+  export->progress = progress;
+  export->data     = data;
+
+  /* indirect documents are written by libdjvu itself */
+  bool indirect    = false;
+  int option_count = 0;
+  while (options != NULL && options[option_count] != NULL) {
+    if (g_str_has_prefix(options[option_count], "-indirect=") == TRUE) {
+      indirect = true;
+    }
+    option_count++;
+  }
+
+  if (indirect == false) {
+    export->fp = fopen(path, "w");
+    if (export->fp == NULL) {
+      goto error_free;
+    }
+  }
+
+  if (format == DJVU_EXPORT_POSTSCRIPT) {
+    export->job = ddjvu_document_print(djvu_document->document, export->fp, option_count, options);
+  } else {
+    export->job = ddjvu_document_save(djvu_document->document, export->fp, option_count, options);
+  }
+
+  if (export->job == NULL) {
+    goto error_free;
+  }
+
+  /* progress messages are routed to their export by the job's user data */
+  g_mutex_lock(&djvu_document->decoder->dispatch_lock);
+  ddjvu_job_set_user_data(export->job, export);
+  g_mutex_unlock(&djvu_document->decoder->dispatch_lock);
+
+  return export;
+
+error_free:
+
+  if (export->fp != NULL) {
+    fclose(export->fp);
+    g_unlink(export->path);
+  }
+
+  g_free(export->path);
+  free(export);
+
+  if (error != NULL) {
+    *error = ZATHURA_ERROR_UNKNOWN;
+  }
+
+  return NULL;
+}
+
+bool djvu_export_done(djvu_export_t* export) {
+  if (export == NULL) {
+    return true;
+  }
+
+  return ddjvu_job_done(export->job);
+}
+
+void djvu_export_cancel(djvu_export_t* export) {
+  if (export == NULL) {
+    return;
+  }
+
+  ddjvu_job_stop(export->job);
+  export->cancelled = true;
+
+  /* a job that is still writing keeps the unlinked file open until it stops */
+  g_unlink(export->path);
+}
+
+zathura_error_t djvu_export_finish(djvu_export_t* export) {
+  if (export == NULL) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  while (ddjvu_job_done(export->job) == FALSE) {
+    handle_messages(export->document, true);
+  }
+
+  zathura_error_t error = ZATHURA_ERROR_OK;
+  if (export->cancelled == true || ddjvu_job_status(export->job) != DDJVU_JOB_OK) {
+    error = ZATHURA_ERROR_UNKNOWN;
+  }
+
+  /* messages still queued in a shared context must not reach the freed export */
+  g_mutex_lock(&export->document->decoder->dispatch_lock);
+  ddjvu_job_set_user_data(export->job, NULL);
+  g_mutex_unlock(&export->document->decoder->dispatch_lock);
+  ddjvu_job_release(export->job);
+
+  if (export->fp != NULL) {
+    if (fclose(export->fp) != 0) {
+      error = ZATHURA_ERROR_UNKNOWN;
+    }
+
+    if (error != ZATHURA_ERROR_OK) {
+      g_unlink(export->path);
+    }
+  }
+
+  g_free(export->path);
+  free(export);
+
+  return error;
+}
+
+void djvu_export_handle_message(const ddjvu_message_t* message) {
+  if (message == NULL || message->m_any.tag != DDJVU_PROGRESS || message->m_any.job == NULL) {
+    return;
+  }
+
+  djvu_export_t* export = ddjvu_job_get_user_data(message->m_any.job);
+  if (export != NULL && export->progress != NULL) {
+    export->progress(message->m_progress.percent, export->data);
+  }
+}
@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_EXPORT_H
+#define DJVU_EXPORT_H
+
+#include <stdbool.h>
+
+#include "djvu.h"
+
+/**
+ * Export job
+ */
+typedef struct djvu_export_s djvu_export_t;
+
+/**
+ * Export format
+ */
+typedef enum djvu_export_format_e {
+  DJVU_EXPORT_DJVU,       /**< DjVu document */
+  DJVU_EXPORT_POSTSCRIPT, /**< PostScript */
+  DJVU_EXPORT_PNG,        /**< One PNG image per page */
+  DJVU_EXPORT_PNM,        /**< Stream of binary PPM images */
+  DJVU_EXPORT_TEXT,       /**< Plain text */
+  DJVU_EXPORT_HOCR,       /**< hOCR */
+  DJVU_EXPORT_JSON,       /**< JSON with word boxes */
+} djvu_export_format_t;
+
+/**
+ * Collects the export options configured in the environment.
+ * ZATHURA_DJVU_PAGES limits PostScript exports to a page specification such
+ * as "1-10,15", ZATHURA_DJVU_SAVE_PAGES does the same for DjVu. PostScript
+ * exports take further ddjvu print options (e.g. "-mode=black -level=2
+ * -zoom=100") from ZATHURA_DJVU_PRINT_OPTIONS. DjVu exports are written as
+ * indirect documents, i.e. an index file next to one file per component, if
+ * ZATHURA_DJVU_INDIRECT is enabled.
+ *
+ * @param format Output format
+ * @param path Output file
+ * @return NULL terminated list of options (needs to be deallocated with
+ *   g_strfreev)
+ */
+char** djvu_export_get_options(djvu_export_format_t format, const char* path);
+
+/**
+ * Returns the pages selected by ZATHURA_DJVU_PAGES, a comma separated list
+ * of page numbers and ranges such as "1-10,15". All pages are selected if
+ * the variable is not set.
+ *
+ * @param document The document
+ * @return Array of page indices (needs to be deallocated with g_array_free)
+ *   or NULL if the page specification is invalid
+ */
+GArray* djvu_export_get_pages(djvu_document_t* document);
+
+/**
+ * Renders the selected pages to images at the resolution set by
+ * ZATHURA_DJVU_EXPORT_DPI. Pages are decoded ahead of the page being written
+ * in a bounded window, and PPM output is written in strips. Pages that cannot
+ * be decoded are skipped with a warning. If an image cannot be written, all
+ * output of the export is removed.
+ *
+ * @param document The document
+ * @param path Output file. PNG exports of multiple pages insert the page
+ *   number before the extension.
+ * @param format DJVU_EXPORT_PNG or DJVU_EXPORT_PNM
+ * @return ZATHURA_ERROR_OK when no error occurred, otherwise see
+ *    zathura_error_t
+ */
+zathura_error_t djvu_export_images(djvu_document_t* document, const char* path, djvu_export_format_t format);
+
+/**
+ * Writes the hidden text layer of the selected pages (see
+ * djvu_export_get_pages). Pages are fetched and written one by one. Boxes in
+ * hOCR and JSON output use the top left corner of the page as origin.
+ *
+ * @param document The document
+ * @param path Output file
+ * @param format DJVU_EXPORT_TEXT, DJVU_EXPORT_HOCR or DJVU_EXPORT_JSON
+ * @return ZATHURA_ERROR_OK when no error occurred, otherwise see
+ *    zathura_error_t
+ */
+zathura_error_t djvu_export_text(djvu_document_t* document, const char* path, djvu_export_format_t format);
+
+/**
+ * Progress callback
+ *
+ * @param percent Progress in percent
+ * @param data Custom data
+ */
+typedef void (*djvu_export_progress_t)(int percent, void* data);
+
+/**
+ * Starts exporting a document in the background
+ *
+ * @param document The document
+ * @param path Output file
+ * @param format Output format
+ * @param options NULL terminated list of ddjvu save or print options or NULL
+ * @param progress Progress callback or NULL
+ * @param data Custom data passed to the progress callback
+ * @param error Set to an error value (see zathura_error_t) if an error
+ *   occurred
+ * @return The export job or NULL if an error occurred
+ */
+djvu_export_t* djvu_export_start(djvu_document_t* document, const char* path, djvu_export_format_t format,
+                                 const char* const* options, djvu_export_progress_t progress, void* data,
+                                 zathura_error_t* error);
+
+/**
+ * Checks if an export job has finished
+ *
+ * @param export The export job
+ * @return true if the job has finished, failed or was cancelled
+ */
+bool djvu_export_done(djvu_export_t* export);
+
+/**
+ * Cancels an export job and removes the partial output. The job still has to
+ * be finished with djvu_export_finish, which then reports an error.
+ *
+ * @param export The export job
+ */
+void djvu_export_cancel(djvu_export_t* export);
+
+/**
+ * Waits for an export job to finish and frees it. The output file is removed
+ * if the job failed or was cancelled.
+ *
+ * @param export The export job
+ * @return ZATHURA_ERROR_OK when no error occurred, otherwise see
+ *    zathura_error_t
+ */
+zathura_error_t djvu_export_finish(djvu_export_t* export);
+
+/**
+ * Forwards a DDJVU_PROGRESS message to the export job it belongs to
+ *
+ * @param message The message
+ */
+void djvu_export_handle_message(const ddjvu_message_t* message);
+
+#endif // DJVU_EXPORT_H
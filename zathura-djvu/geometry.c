@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "geometry.h"
+#include "djvu.h"
+#include "internal.h"
+
+/* forward declarations */
+static void transform_rectangle(const cairo_matrix_t* matrix, zathura_rectangle_t* rectangle);
+static void transform_list_element(void* data, void* user_data);
+
+void djvu_geometry_init(djvu_geometry_t* geometry, const ddjvu_pageinfo_t* page_info) {
+  if (geometry == NULL || page_info == NULL) {
+    return;
+  }
+
+  /* the page info already accounts for the intrinsic rotation */
+  geometry->width    = page_info->width;
+  geometry->height   = page_info->height;
+  geometry->dpi      = page_info->dpi;
+  geometry->rotation = (page_info->rotation & 3) * 90;
+
+  /* pages without a sensible resolution keep the historic scale */
+  geometry->scale = (page_info->dpi > 0) ? 72.0 / page_info->dpi : ZATHURA_DJVU_SCALE;
+
+  const double width  = geometry->width;
+  const double height = geometry->height;
+
+  /* rotate the unrotated page and move the origin to the top left corner */
+  cairo_matrix_t orientation;
+  switch (geometry->rotation) {
+  case 90:
+    cairo_matrix_init(&orientation, 0, -1, -1, 0, width, height);
+    break;
+  case 180:
+    cairo_matrix_init(&orientation, -1, 0, 0, 1, width, 0);
+    break;
+  case 270:
+    cairo_matrix_init(&orientation, 0, 1, 1, 0, 0, 0);
+    break;
+  default:
+    cairo_matrix_init(&orientation, 1, 0, 0, -1, 0, height);
+    break;
+  }
+
+  cairo_matrix_t scale;
+  cairo_matrix_init_scale(&scale, geometry->scale, geometry->scale);
+  cairo_matrix_multiply(&geometry->to_page, &orientation, &scale);
+
+  cairo_matrix_t to_text = geometry->to_page;
+  if (cairo_matrix_invert(&to_text) != CAIRO_STATUS_SUCCESS) {
+    cairo_matrix_init_identity(&to_text);
+  }
+
+  /* undo the rotation of the view before mapping points to pixels */
+  const double page_width  = djvu_geometry_get_width(geometry);
+  const double page_height = djvu_geometry_get_height(geometry);
+
+  cairo_matrix_t view[4];
+  cairo_matrix_init_identity(&view[0]);
+  cairo_matrix_init(&view[1], 0, -1, 1, 0, 0, page_height);
+  cairo_matrix_init(&view[2], -1, 0, 0, -1, page_width, page_height);
+  cairo_matrix_init(&view[3], 0, 1, -1, 0, page_width, 0);
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS(view); i++) {
+    cairo_matrix_multiply(&geometry->view_to_text[i], &view[i], &to_text);
+  }
+}
+
+double djvu_geometry_get_width(const djvu_geometry_t* geometry) {
+  return geometry->width * geometry->scale;
+}
+
+double djvu_geometry_get_height(const djvu_geometry_t* geometry) {
+  return geometry->height * geometry->scale;
+}
+
+void djvu_geometry_to_page(const djvu_geometry_t* geometry, zathura_rectangle_t* rectangle) {
+  if (geometry == NULL || rectangle == NULL) {
+    return;
+  }
+
+  transform_rectangle(&geometry->to_page, rectangle);
+}
+
+void djvu_geometry_view_to_text(const djvu_geometry_t* geometry, int rotation, zathura_rectangle_t* rectangle) {
+  if (geometry == NULL || rectangle == NULL) {
+    return;
+  }
+
+  /* zathura only rotates in steps of 90 degrees */
+  const unsigned int step = (((rotation / 90) % 4) + 4) % 4;
+  transform_rectangle(&geometry->view_to_text[step], rectangle);
+}
+
+void djvu_geometry_list_to_page(const djvu_geometry_t* geometry, girara_list_t* rectangles) {
+  if (geometry == NULL || rectangles == NULL) {
+    return;
+  }
+
+  girara_list_foreach(rectangles, transform_list_element, (void*)&geometry->to_page);
+}
+
+static void transform_rectangle(const cairo_matrix_t* matrix, zathura_rectangle_t* rectangle) {
+  double x1 = rectangle->x1;
+  double y1 = rectangle->y1;
+  double x2 = rectangle->x2;
+  double y2 = rectangle->y2;
+
+  cairo_matrix_transform_point(matrix, &x1, &y1);
+  cairo_matrix_transform_point(matrix, &x2, &y2);
+
+  /* rotations and flips swap the corners */
+  rectangle->x1 = MIN(x1, x2);
+  rectangle->x2 = MAX(x1, x2);
+  rectangle->y1 = MIN(y1, y2);
+  rectangle->y2 = MAX(y1, y2);
+}
+
+static void transform_list_element(void* data, void* user_data) {
+  transform_rectangle(user_data, data);
+}
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_GEOMETRY_H
+#define DJVU_GEOMETRY_H
+
+#include <cairo.h>
+#include <girara/datastructures.h>
+#include <zathura/types.h>
+#include <libdjvu/ddjvuapi.h>
+
+/**
+ * Geometry of a page
+ *
+ * The text layer and the annotations of a page use pixel coordinates of the
+ * unrotated page with the origin in the bottom left corner. zathura expects
+ * points on the displayed page with the origin in the top left corner.
+ */
+typedef struct djvu_geometry_s {
+  int width;              /**< Width of the displayed page in pixels */
+  int height;             /**< Height of the displayed page in pixels */
+  int dpi;                /**< Resolution of the page */
+  int rotation;           /**< Intrinsic rotation in degrees counter-clockwise */
+  double scale;           /**< Points per pixel */
+  cairo_matrix_t to_page; /**< Maps pixel coordinates to points */
+
+  cairo_matrix_t view_to_text[4]; /**< Maps points of the view rotated by 0, 90, 180 and 270 degrees to pixels */
+} djvu_geometry_t;
+
+/**
+ * Computes the geometry of a page from its page info. The size in points is
+ * derived from the resolution of the page, so pages scanned at different
+ * resolutions are shown at their physical size.
+ *
+ * @param geometry The geometry to fill
+ * @param page_info Page info by ddjvu_document_get_pageinfo
+ */
+void djvu_geometry_init(djvu_geometry_t* geometry, const ddjvu_pageinfo_t* page_info);
+
+/**
+ * Returns the width of the displayed page in points
+ *
+ * @param geometry The geometry
+ * @return Width in points
+ */
+double djvu_geometry_get_width(const djvu_geometry_t* geometry);
+
+/**
+ * Returns the height of the displayed page in points
+ *
+ * @param geometry The geometry
+ * @return Height in points
+ */
+double djvu_geometry_get_height(const djvu_geometry_t* geometry);
+
+/**
+ * Maps a rectangle in pixel coordinates of the text layer to points
+ *
+ * @param geometry The geometry
+ * @param rectangle The rectangle
+ */
+void djvu_geometry_to_page(const djvu_geometry_t* geometry, zathura_rectangle_t* rectangle);
+
+/**
+ * Maps a rectangle in points of a rotated view to pixel coordinates of the
+ * text layer
+ *
+ * @param geometry The geometry
+ * @param rotation Rotation of the view in degrees (0, 90, 180 or 270)
+ * @param rectangle The rectangle
+ */
+void djvu_geometry_view_to_text(const djvu_geometry_t* geometry, int rotation, zathura_rectangle_t* rectangle);
+
+/**
+ * Maps a list of rectangles in pixel coordinates of the text layer to points
+ *
+ * @param geometry The geometry
+ * @param rectangles List of zathura_rectangle_t
+ */
+void djvu_geometry_list_to_page(const djvu_geometry_t* geometry, girara_list_t* rectangles);
+
+#endif // DJVU_GEOMETRY_H
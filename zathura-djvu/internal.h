@@ -6,6 +6,20 @@
 #include <girara/macros.h>
 
 #define ZATHURA_DJVU_SCALE 0.2
+#define ZATHURA_DJVU_THUMBNAIL_SIZE 128
+#define ZATHURA_DJVU_MEMORY_BUDGET 256
+#define ZATHURA_DJVU_PAGE_SIZE_ESTIMATE (16 * 1024 * 1024)
+#define ZATHURA_DJVU_PREFETCH_DISTANCE 1
+#define ZATHURA_DJVU_STREAM_READ_SIZE (64 * 1024)
+#define ZATHURA_DJVU_STREAM_READERS 4
+#define ZATHURA_DJVU_STREAM_TIMEOUT 2000
+#define ZATHURA_DJVU_STREAM_POLL_INTERVAL (100 * 1000)
+#define ZATHURA_DJVU_EXPORT_DPI 150
+#define ZATHURA_DJVU_EXPORT_WINDOW 4
+#define ZATHURA_DJVU_EXPORT_STRIP_HEIGHT 256
+#define ZATHURA_DJVU_MESSAGE_TIMEOUT (50 * 1000)
+#define ZATHURA_DJVU_MAX_OUTLINE_DEPTH 64
+#define ZATHURA_DJVU_MAX_EXPRESSION_DEPTH 64
 
 void handle_messages(djvu_document_t* document, bool wait);
 
@@ -0,0 +1,293 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <gio/gio.h>
+#include <girara/log.h>
+
+#include "memory.h"
+#include "cache.h"
+#include "config.h"
+#include "internal.h"
+
+#define MIB (1024 * 1024)
+
+/* a pair holds two pointers, strings carry a header besides their data */
+#define EXPRESSION_PAIR_SIZE (2 * sizeof(void*))
+#define EXPRESSION_STRING_SIZE (4 * sizeof(void*))
+
+/* the resident set size is read at most this often (in microseconds) */
+#define MEMORY_CHECK_INTERVAL (G_USEC_PER_SEC / 2)
+
+/* once over the limit, caches are trimmed to get below 7/8 of it, so the
+ * next render does not immediately cross the limit again */
+#define MEMORY_LOW_WATERMARK(limit) ((limit) / 8 * 7)
+
+/* registered documents */
+static GList* documents        = NULL;
+static GMemoryMonitor* monitor = NULL;
+static gulong monitor_handler  = 0;
+static gint64 last_check       = 0;
+G_LOCK_DEFINE_STATIC(documents);
+
+/* forward declarations */
+static size_t get_resident_set_size(void);
+static size_t get_expression_size(miniexp_t expression, unsigned int depth);
+static void divide_budget(void);
+static size_t get_cached_size(void);
+static void release_memory(size_t amount);
+static size_t shrink_documents(void);
+static void cb_low_memory_warning(GMemoryMonitor* monitor, GMemoryMonitorWarningLevel level, gpointer data);
+
+void djvu_memory_budget_get(djvu_memory_budget_t* budget) {
+  if (budget == NULL) {
+    return;
+  }
+
+  const size_t total = djvu_config_get_ulong("ZATHURA_DJVU_MEMORY_BUDGET", ZATHURA_DJVU_MEMORY_BUDGET) * MIB;
+
+  /* the remainder is left for rendering */
+  budget->decoder     = total / 4;
+  budget->pages       = total / 2;
+  budget->thumbnails  = total / 16;
+  budget->renders     = total / 8;
+  budget->texts       = total / 32;
+  budget->annotations = total / 128;
+}
+
+void djvu_memory_get_usage(djvu_document_t* djvu_document, djvu_memory_usage_t* usage) {
+  if (djvu_document == NULL || usage == NULL) {
+    return;
+  }
+
+  usage->pages       = djvu_cache_get_size(djvu_document->pages);
+  usage->thumbnails  = djvu_cache_get_size(djvu_document->thumbnails);
+  usage->renders     = djvu_cache_get_size(djvu_document->renders);
+  usage->texts       = djvu_cache_get_size(djvu_document->texts);
+  usage->annotations = djvu_cache_get_size(djvu_document->annotations);
+}
+
+void djvu_memory_register(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL) {
+    return;
+  }
+
+  G_LOCK(documents);
+  documents = g_list_prepend(documents, djvu_document);
+  divide_budget();
+  if (monitor == NULL) {
+    monitor = g_memory_monitor_dup_default();
+    if (monitor != NULL) {
+      monitor_handler = g_signal_connect(monitor, "low-memory-warning", G_CALLBACK(cb_low_memory_warning), NULL);
+    }
+  }
+  G_UNLOCK(documents);
+}
+
+void djvu_memory_unregister(djvu_document_t* djvu_document) {
+  G_LOCK(documents);
+  documents = g_list_remove(documents, djvu_document);
+  divide_budget();
+
+  /* the monitor is only kept while there is something to trim */
+  if (documents == NULL && monitor != NULL) {
+    g_signal_handler_disconnect(monitor, monitor_handler);
+    g_object_unref(monitor);
+    monitor         = NULL;
+    monitor_handler = 0;
+  }
+  G_UNLOCK(documents);
+}
+
+void djvu_memory_check(void) {
+  const size_t limit = djvu_config_get_ulong("ZATHURA_DJVU_RSS_LIMIT", 0) * MIB;
+  if (limit == 0) {
+    return;
+  }
+
+  /* renders call this for every page, reading /proc that often is wasteful */
+  const gint64 now = g_get_monotonic_time();
+
+  G_LOCK(documents);
+  if (last_check != 0 && now - last_check < MEMORY_CHECK_INTERVAL) {
+    G_UNLOCK(documents);
+    return;
+  }
+  last_check = now;
+
+  const size_t rss = get_resident_set_size();
+  if (rss > limit) {
+    girara_debug("djvu resident set size of %zu KiB exceeds limit, trimming caches", rss / 1024);
+    release_memory(rss - MEMORY_LOW_WATERMARK(limit));
+  }
+  G_UNLOCK(documents);
+}
+
+void djvu_memory_trim(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL) {
+    return;
+  }
+
+  djvu_cache_clear(djvu_document->pages);
+  djvu_cache_clear(djvu_document->thumbnails);
+  djvu_cache_clear(djvu_document->renders);
+  djvu_cache_clear(djvu_document->texts);
+  djvu_cache_clear(djvu_document->annotations);
+  ddjvu_cache_clear(djvu_document->context);
+}
+
+void djvu_memory_log_usage(djvu_document_t* djvu_document) {
+  djvu_memory_usage_t usage = {0};
+  djvu_memory_get_usage(djvu_document, &usage);
+
+  girara_debug("djvu memory usage: page cache %zu KiB, thumbnail cache %zu KiB, render cache %zu KiB, "
+               "text cache %zu KiB, annotation cache %zu KiB",
+               usage.pages / 1024, usage.thumbnails / 1024, usage.renders / 1024, usage.texts / 1024,
+               usage.annotations / 1024);
+}
+
+size_t djvu_memory_get_expression_size(miniexp_t expression) {
+  return get_expression_size(expression, 0);
+}
+
+static size_t get_resident_set_size(void) {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == NULL) {
+    return 0;
+  }
+
+  unsigned long size     = 0;
+  unsigned long resident = 0;
+  if (fscanf(fp, "%lu %lu", &size, &resident) != 2) {
+    resident = 0;
+  }
+  fclose(fp);
+
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+static size_t get_expression_size(miniexp_t expression, unsigned int depth) {
+  size_t size = 0;
+
+  /* lists are walked iteratively, only nested lists recurse */
+  for (; miniexp_consp(expression) != 0; expression = miniexp_cdr(expression)) {
+    size += EXPRESSION_PAIR_SIZE;
+    if (depth < ZATHURA_DJVU_MAX_EXPRESSION_DEPTH) {
+      size += get_expression_size(miniexp_car(expression), depth + 1);
+    }
+  }
+
+  if (miniexp_stringp(expression) != 0) {
+    size += EXPRESSION_STRING_SIZE + strlen(miniexp_to_str(expression));
+  }
+
+  return size;
+}
+
+/* called with the documents lock held */
+static void divide_budget(void) {
+  const unsigned int number_of_documents = g_list_length(documents);
+  if (number_of_documents == 0) {
+    return;
+  }
+
+  /* documents sharing a decoder context share its cache as well */
+  unsigned int number_of_contexts = 0;
+  for (GList* iter = documents; iter != NULL; iter = iter->next) {
+    const djvu_document_t* djvu_document = iter->data;
+
+    GList* other = documents;
+    while (other != iter && ((djvu_document_t*)other->data)->decoder != djvu_document->decoder) {
+      other = other->next;
+    }
+
+    if (other == iter) {
+      number_of_contexts++;
+    }
+  }
+
+  djvu_memory_budget_t budget;
+  djvu_memory_budget_get(&budget);
+
+  for (GList* iter = documents; iter != NULL; iter = iter->next) {
+    djvu_document_t* djvu_document = iter->data;
+
+    djvu_cache_set_max_size(djvu_document->pages, budget.pages / number_of_documents);
+    djvu_cache_set_max_size(djvu_document->thumbnails, budget.thumbnails / number_of_documents);
+    djvu_cache_set_max_size(djvu_document->renders, budget.renders / number_of_documents);
+    djvu_cache_set_max_size(djvu_document->texts, budget.texts / number_of_documents);
+    djvu_cache_set_max_size(djvu_document->annotations, budget.annotations / number_of_documents);
+    ddjvu_cache_set_size(djvu_document->context, budget.decoder / number_of_contexts);
+  }
+}
+
+/* called with the documents lock held */
+static size_t get_cached_size(void) {
+  size_t size = 0;
+  for (GList* iter = documents; iter != NULL; iter = iter->next) {
+    djvu_memory_usage_t usage = {0};
+    djvu_memory_get_usage(iter->data, &usage);
+    size += usage.pages + usage.thumbnails + usage.renders + usage.texts + usage.annotations;
+  }
+
+  return size;
+}
+
+/* called with the documents lock held */
+static void release_memory(size_t amount) {
+  /* freed memory does not necessarily leave the resident set, so progress is
+   * measured by what the caches report instead of re-reading the RSS */
+  size_t released = 0;
+  while (released < amount) {
+    const size_t step = shrink_documents();
+    if (step == 0) {
+      break;
+    }
+    released += step;
+  }
+
+  /* the decoded components held by libdjvu are the last resort */
+  if (released < amount) {
+    for (GList* iter = documents; iter != NULL; iter = iter->next) {
+      djvu_memory_trim(iter->data);
+    }
+  }
+}
+
+/* halves every cache of every document, dropping the least recently used
+ * entries first, and returns the number of bytes released */
+static size_t shrink_documents(void) {
+  size_t released = 0;
+
+  for (GList* iter = documents; iter != NULL; iter = iter->next) {
+    djvu_document_t* djvu_document = iter->data;
+    djvu_cache_t* caches[]         = {djvu_document->renders, djvu_document->thumbnails, djvu_document->texts,
+                                      djvu_document->pages, djvu_document->annotations};
+
+    for (unsigned int i = 0; i < G_N_ELEMENTS(caches); i++) {
+      const size_t size = djvu_cache_get_size(caches[i]);
+      djvu_cache_shrink(caches[i], size / 2);
+      released += size - djvu_cache_get_size(caches[i]);
+    }
+  }
+
+  return released;
+}
+
+static void cb_low_memory_warning(GMemoryMonitor* UNUSED(monitor), GMemoryMonitorWarningLevel level,
+                                  gpointer UNUSED(data)) {
+  girara_debug("djvu low memory warning (level %d), trimming caches", level);
+
+  /* the more urgent the warning, the more is released */
+  G_LOCK(documents);
+  const size_t cached = get_cached_size();
+  if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL) {
+    release_memory(G_MAXSIZE);
+  } else if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM) {
+    release_memory(cached / 4 * 3);
+  } else {
+    release_memory(cached / 2);
+  }
+  G_UNLOCK(documents);
+}
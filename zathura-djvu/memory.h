@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_MEMORY_H
+#define DJVU_MEMORY_H
+
+#include <stddef.h>
+
+#include "djvu.h"
+
+/**
+ * Memory limits derived from the configured budget
+ */
+typedef struct djvu_memory_budget_s {
+  size_t decoder;     /**< Size of the libdjvu decoder cache */
+  size_t pages;       /**< Size of the page cache */
+  size_t thumbnails;  /**< Size of the thumbnail cache */
+  size_t renders;     /**< Size of the render cache */
+  size_t texts;       /**< Size of the text layer cache */
+  size_t annotations; /**< Size of the annotation cache */
+} djvu_memory_budget_t;
+
+/**
+ * Memory usage of a document
+ */
+typedef struct djvu_memory_usage_s {
+  size_t pages;       /**< Current size of the page cache */
+  size_t thumbnails;  /**< Current size of the thumbnail cache */
+  size_t renders;     /**< Current size of the render cache */
+  size_t texts;       /**< Current size of the text layer cache */
+  size_t annotations; /**< Current size of the annotation cache */
+} djvu_memory_usage_t;
+
+/**
+ * Splits the memory budget set by ZATHURA_DJVU_MEMORY_BUDGET (in MiB) among
+ * the decoder and the caches of the plugin. The budget holds for the whole
+ * process, registered documents share it (see djvu_memory_register).
+ *
+ * @param budget The budget to fill
+ */
+void djvu_memory_budget_get(djvu_memory_budget_t* budget);
+
+/**
+ * Returns the memory usage of the caches of a document. libdjvu does not
+ * report how much of its decoder cache is in use, so it is not included.
+ *
+ * @param document The document
+ * @param usage The usage to fill
+ */
+void djvu_memory_get_usage(djvu_document_t* document, djvu_memory_usage_t* usage);
+
+/**
+ * Logs the memory usage of a document
+ *
+ * @param document The document
+ */
+void djvu_memory_log_usage(djvu_document_t* document);
+
+/**
+ * Registers a document for global cache eviction. The memory budget is
+ * divided evenly among all registered documents, whose cache limits are
+ * adjusted whenever a document is registered or unregistered. Decoder
+ * contexts shared by several documents get one share of the decoder budget
+ * between them. Caches of registered documents are trimmed once the resident
+ * set size exceeds the limit set by ZATHURA_DJVU_RSS_LIMIT (in MiB) or when
+ * the system reports memory pressure.
+ *
+ * @param document The document
+ */
+void djvu_memory_register(djvu_document_t* document);
+
+/**
+ * Removes a document from global cache eviction and hands its share of the
+ * memory budget to the remaining documents
+ *
+ * @param document The document
+ */
+void djvu_memory_unregister(djvu_document_t* document);
+
+/**
+ * Trims the caches of all registered documents if the resident set size
+ * exceeds its limit. The resident set size is read at most twice a second.
+ * Caches are halved step by step, least recently used entries first, until
+ * enough has been released to get below 7/8 of the limit.
+ */
+void djvu_memory_check(void);
+
+/**
+ * Estimates the memory held by an expression returned by libdjvu
+ *
+ * @param expression The expression
+ * @return Estimated size in bytes
+ */
+size_t djvu_memory_get_expression_size(miniexp_t expression);
+
+/**
+ * Drops all cached pages, thumbnails, renders, text layers, annotations and
+ * decoded components of a document
+ *
+ * @param document The document
+ */
+void djvu_memory_trim(djvu_document_t* document);
+
+#endif // DJVU_MEMORY_H
@@ -2,10 +2,14 @@
 
 #include <libdjvu/miniexp.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <glib.h>
 
 #include "page-text.h"
+#include "cache.h"
+#include "memory.h"
+#include "stats.h"
 #include "internal.h"
 
 /**
@@ -16,55 +20,108 @@ typedef struct text_position_s {
   miniexp_t exp;         /**< Correspondending expression */
 } text_position_t;
 
+/**
+ * Box of a character of a refined word
+ */
+typedef struct text_character_s {
+  unsigned int length;           /**< Length of the character in bytes */
+  zathura_rectangle_t rectangle; /**< Box in pixel coordinates */
+} text_character_t;
+
+/**
+ * Box of a token
+ */
+typedef struct text_box_s {
+  zathura_rectangle_t rectangle; /**< Box in pixel coordinates */
+  unsigned int line;             /**< Index of the line of the token */
+} text_box_t;
+
 /* forward declaration */
-static void djvu_page_text_content_append(djvu_page_text_t* page_text, miniexp_t exp);
-static miniexp_t text_position_get_exp(djvu_page_text_t* page_text, unsigned int index);
-static bool djvu_page_text_build_rectangle(djvu_page_text_t* page_text, miniexp_t exp, miniexp_t start, miniexp_t end);
-static bool djvu_page_text_build_rectangle_process(djvu_page_text_t* page_text, miniexp_t exp, miniexp_t start,
-                                                   miniexp_t end);
+static void djvu_page_text_content_append(djvu_page_text_t* page_text, GString* content, miniexp_t exp);
+static int text_position_get_index(djvu_page_text_t* page_text, unsigned int index);
+static void djvu_page_text_build_rectangle(djvu_page_text_t* page_text, unsigned int start, unsigned int end,
+                                           unsigned int begin_byte, unsigned int end_byte);
+static bool djvu_page_text_refine(djvu_page_text_t* page_text, unsigned int token, unsigned int begin,
+                                  unsigned int end, zathura_rectangle_t* rectangle);
+static GArray* djvu_page_text_get_characters(djvu_page_text_t* page_text, unsigned int token);
+static void djvu_page_text_release_characters(djvu_page_text_t* page_text);
+static void djvu_page_text_collect_words(djvu_page_text_t* page_text, miniexp_t exp);
 static void djvu_page_text_limit(djvu_page_text_t* page_text, miniexp_t exp, zathura_rectangle_t* rectangle);
 static void djvu_page_text_limit_process(djvu_page_text_t* page_text, miniexp_t exp, zathura_rectangle_t* rectangle);
-static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t exp, int delimiter);
-
-djvu_page_text_t* djvu_page_text_new(djvu_document_t* document, zathura_page_t* page) {
-  if (document == NULL || document->document == NULL || page == NULL) {
+static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t exp, int delimiter,
+                                          GString** content);
+static void djvu_page_text_collect_boxes(djvu_page_text_t* page_text, miniexp_t exp, int line,
+                                         unsigned int* line_count);
+static void exp_to_box(miniexp_t exp, zathura_rectangle_t* rectangle);
+static bool rectangle_intersects(const zathura_rectangle_t* a, const zathura_rectangle_t* b);
+static size_t array_get_size(GArray* array);
+
+djvu_page_text_t* djvu_page_text_new(djvu_document_t* document, unsigned int index) {
+  if (document == NULL || document->document == NULL) {
     goto error_ret;
   }
 
-  djvu_page_text_t* page_text = calloc(1, sizeof(djvu_page_text_t));
-  if (page_text == NULL) {
-    goto error_ret;
+  /* results are mapped to points on the displayed page */
+  ddjvu_status_t status;
+  ddjvu_pageinfo_t page_info;
+  while ((status = ddjvu_document_get_pageinfo(document->document, index, &page_info)) < DDJVU_JOB_OK) {
+    handle_messages(document, true);
   }
 
-  page_text->text_information = miniexp_nil;
-  page_text->begin            = miniexp_nil;
-  page_text->end              = miniexp_nil;
-  page_text->document         = document;
-  page_text->page             = page;
+  if (status >= DDJVU_JOB_FAILED) {
+    goto error_ret;
+  }
 
-  /* read page text */
-  while ((page_text->text_information =
-              ddjvu_document_get_pagetext(document->document, zathura_page_get_index(page), "char")) == miniexp_dummy) {
+  /* words are enough for searching and selecting, characters are only
+   * fetched to narrow down search hits that start or end inside a word */
+  miniexp_t text_information = miniexp_nil;
+  while ((text_information = ddjvu_document_get_pagetext(document->document, index, "word")) == miniexp_dummy) {
     handle_messages(document, true);
   }
 
-  if (page_text->text_information == miniexp_nil) {
-    goto error_free;
+  if (text_information == miniexp_nil) {
+    goto error_ret;
+  }
+
+  djvu_page_text_t* page_text = djvu_page_text_new_from_expression(text_information, &page_info);
+  if (page_text == NULL) {
+    goto error_release;
   }
 
+  page_text->document = document;
+  page_text->index    = index;
+
   return page_text;
 
-error_free:
+error_release:
 
-  if (page_text != NULL) {
-    djvu_page_text_free(page_text);
-  }
+  ddjvu_miniexp_release(document->document, text_information);
 
 error_ret:
 
   return NULL;
 }
 
+djvu_page_text_t* djvu_page_text_new_from_expression(miniexp_t text, const ddjvu_pageinfo_t* page_info) {
+  if (text == miniexp_nil || page_info == NULL) {
+    return NULL;
+  }
+
+  djvu_page_text_t* page_text = calloc(1, sizeof(djvu_page_text_t));
+  if (page_text == NULL) {
+    return NULL;
+  }
+
+  page_text->text_information = text;
+  page_text->characters       = miniexp_nil;
+  page_text->begin            = miniexp_nil;
+  page_text->end              = miniexp_nil;
+  page_text->size             = djvu_memory_get_expression_size(text);
+  djvu_geometry_init(&page_text->geometry, page_info);
+
+  return page_text;
+}
+
 void djvu_page_text_free(djvu_page_text_t* page_text) {
   if (page_text == NULL) {
     return;
@@ -74,12 +131,28 @@ void djvu_page_text_free(djvu_page_text_t* page_text) {
     ddjvu_miniexp_release(page_text->document->document, page_text->text_information);
   }
 
+  djvu_page_text_release_characters(page_text);
+
+  if (page_text->word_characters != NULL) {
+    g_hash_table_destroy(page_text->word_characters);
+  }
+
+  if (page_text->search_matches != NULL) {
+    g_array_free(page_text->search_matches, TRUE);
+  }
+
+  g_free(page_text->search_query);
+
   if (page_text->content != NULL) {
     g_free(page_text->content);
   }
 
   if (page_text->text_positions != NULL) {
-    girara_list_free(page_text->text_positions);
+    g_array_free(page_text->text_positions, TRUE);
+  }
+
+  if (page_text->boxes != NULL) {
+    g_array_free(page_text->boxes, TRUE);
   }
 
   if (page_text->rectangle != NULL) {
@@ -89,53 +162,132 @@ void djvu_page_text_free(djvu_page_text_t* page_text) {
   free(page_text);
 }
 
-girara_list_t* djvu_page_text_search(djvu_page_text_t* page_text, const char* text) {
-  if (page_text == NULL || text == NULL) {
-    goto error_ret;
+djvu_page_text_t* djvu_page_text_take(djvu_document_t* document, unsigned int index) {
+  if (document == NULL) {
+    return NULL;
+  }
+
+  djvu_page_text_t* page_text = djvu_cache_take(document->texts, index);
+  if (page_text != NULL) {
+    return page_text;
+  }
+
+  const gint64 start = djvu_stats_begin();
+  page_text          = djvu_page_text_new(document, index);
+  djvu_stats_end(DJVU_STATS_TEXT_FETCH, start);
+
+  return page_text;
+}
+
+void djvu_page_text_return(djvu_document_t* document, djvu_page_text_t* page_text) {
+  if (document == NULL || page_text == NULL) {
+    return;
+  }
+
+  djvu_cache_insert(document->texts, page_text->index, page_text, djvu_page_text_get_size(page_text));
+}
+
+size_t djvu_page_text_get_size(djvu_page_text_t* page_text) {
+  if (page_text == NULL) {
+    return 0;
   }
 
-  /* clean and reset */
+  size_t size = sizeof(djvu_page_text_t) + page_text->size;
   if (page_text->content != NULL) {
-    g_free(page_text->content);
-    page_text->content = NULL;
+    size += strlen(page_text->content) + 1;
+  }
+  if (page_text->search_query != NULL) {
+    size += strlen(page_text->search_query) + 1;
   }
 
-  if (page_text->text_positions != NULL) {
-    girara_list_free(page_text->text_positions);
-    page_text->text_positions = NULL;
+  if (page_text->word_characters != NULL) {
+    GHashTableIter iter;
+    gpointer characters = NULL;
+    g_hash_table_iter_init(&iter, page_text->word_characters);
+    while (g_hash_table_iter_next(&iter, NULL, &characters) == TRUE) {
+      size += sizeof(GArray) + array_get_size(characters);
+    }
   }
 
-  /* create result list */
-  girara_list_t* results = girara_list_new_with_free((girara_free_function_t)free);
+  size += array_get_size(page_text->search_matches);
+  size += array_get_size(page_text->text_positions);
+  size += array_get_size(page_text->boxes);
 
-  if (results == NULL) {
-    goto error_ret;
+  return size;
+}
+
+girara_list_t* djvu_page_text_search(djvu_page_text_t* page_text, const char* text) {
+  if (page_text == NULL || text == NULL || text[0] == '\0') {
+    return NULL;
+  }
+
+  /* the content and its position index are built once per page */
+  if (page_text->content == NULL) {
+    page_text->text_positions = g_array_new(FALSE, FALSE, sizeof(text_position_t));
+
+    GString* content = g_string_new(NULL);
+    djvu_page_text_content_append(page_text, content, page_text->text_information);
+    page_text->content = g_string_free(content, FALSE);
+  }
+
+  if (page_text->content[0] == '\0') {
+    return NULL;
   }
 
-  /* create list */
-  page_text->text_positions = girara_list_new_with_free((girara_free_function_t)free);
+  const size_t search_length = strlen(text);
 
-  if (page_text->text_positions == NULL) {
-    goto error_free;
+  /* while a query is typed, every occurrence of the new query starts at an
+   * occurrence of the previous one */
+  if (page_text->search_query != NULL &&
+      strncasecmp(text, page_text->search_query, strlen(page_text->search_query)) == 0) {
+    guint kept = 0;
+    for (guint i = 0; i < page_text->search_matches->len; i++) {
+      const unsigned int candidate = g_array_index(page_text->search_matches, unsigned int, i);
+      if (strncasecmp(page_text->content + candidate, text, search_length) == 0) {
+        g_array_index(page_text->search_matches, unsigned int, kept++) = candidate;
+      }
+    }
+    g_array_set_size(page_text->search_matches, kept);
+  } else {
+    if (page_text->search_matches == NULL) {
+      page_text->search_matches = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+    }
+    g_array_set_size(page_text->search_matches, 0);
+
+    /* overlapping occurrences are kept as candidates for longer queries */
+    for (const char* tmp = page_text->content; (tmp = strcasestr(tmp, text)) != NULL; tmp++) {
+      const unsigned int candidate = tmp - page_text->content;
+      g_array_append_val(page_text->search_matches, candidate);
+    }
   }
 
-  /* get page content */
-  djvu_page_text_content_append(page_text, page_text->text_information);
+  g_free(page_text->search_query);
+  page_text->search_query = g_strdup(text);
+
+  /* pages without an occurrence are skipped until the query changes */
+  if (page_text->search_matches->len == 0) {
+    return NULL;
+  }
 
-  if (page_text->content == NULL || strlen(page_text->content) == 0) {
-    goto error_free;
+  /* create result list */
+  girara_list_t* results = girara_list_new_with_free((girara_free_function_t)free);
+  if (results == NULL) {
+    return NULL;
   }
 
-  /* search through content */
-  int search_length = strlen(text);
-  char* tmp         = page_text->content;
+  /* report non-overlapping occurrences */
+  unsigned int next = 0;
+  for (guint i = 0; i < page_text->search_matches->len; i++) {
+    const unsigned int start_pointer = g_array_index(page_text->search_matches, unsigned int, i);
+    if (start_pointer < next) {
+      continue;
+    }
 
-  while ((tmp = strcasestr(tmp, text)) != NULL) {
-    int start_pointer = tmp - page_text->content;
-    int end_pointer   = start_pointer + search_length - 1;
+    const unsigned int end_pointer = start_pointer + search_length - 1;
+    next                           = start_pointer + search_length;
 
-    miniexp_t start = text_position_get_exp(page_text, start_pointer);
-    miniexp_t end   = text_position_get_exp(page_text, end_pointer);
+    int start = text_position_get_index(page_text, start_pointer);
+    int end   = text_position_get_index(page_text, end_pointer);
 
     /* reset rectangle */
     if (page_text->rectangle != NULL) {
@@ -143,64 +295,32 @@ girara_list_t* djvu_page_text_search(djvu_page_text_t* page_text, const char* te
       page_text->rectangle = NULL;
     }
 
-    djvu_page_text_build_rectangle(page_text, page_text->text_information, start, end);
+    if (start >= 0 && end >= start) {
+      djvu_page_text_build_rectangle(page_text, start, end, start_pointer, end_pointer);
+    }
 
     if (page_text->rectangle == NULL) {
-      tmp += search_length;
       continue;
     }
 
-    /* scale rectangle coordinates */
-    page_text->rectangle->x1 = ZATHURA_DJVU_SCALE * page_text->rectangle->x1;
-    page_text->rectangle->x2 = ZATHURA_DJVU_SCALE * page_text->rectangle->x2;
-    page_text->rectangle->y1 = ZATHURA_DJVU_SCALE * page_text->rectangle->y1;
-    page_text->rectangle->y2 = ZATHURA_DJVU_SCALE * page_text->rectangle->y2;
-
-    /* invert */
-    int y1                   = zathura_page_get_height(page_text->page) - page_text->rectangle->y1;
-    page_text->rectangle->y1 = zathura_page_get_height(page_text->page) - page_text->rectangle->y2;
-    page_text->rectangle->y2 = y1;
-
     /* add rectangle to result list */
     girara_list_append(results, page_text->rectangle);
     page_text->rectangle = NULL;
-
-    tmp += search_length;
   }
 
-  /* clean up */
-  girara_list_free(page_text->text_positions);
-  page_text->text_positions = NULL;
+  djvu_page_text_release_characters(page_text);
 
   if (girara_list_size(results) == 0) {
     girara_list_free(results);
     return NULL;
   }
 
-  return results;
-
-error_free:
-
-  if (results != NULL) {
-    girara_list_free(results);
-  }
-
-  if (page_text->text_positions != NULL) {
-    girara_list_free(page_text->text_positions);
-    page_text->text_positions = NULL;
-  }
-
-  if (page_text->content != NULL) {
-    g_free(page_text->content);
-    page_text->content = NULL;
-  }
+  djvu_geometry_list_to_page(&page_text->geometry, results);
 
-error_ret:
-
-  return NULL;
+  return results;
 }
 
-static void djvu_page_text_content_append(djvu_page_text_t* page_text, miniexp_t exp) {
+static void djvu_page_text_content_append(djvu_page_text_t* page_text, GString* content, miniexp_t exp) {
   if (page_text == NULL || exp == miniexp_nil) {
     return;
   }
@@ -214,33 +334,24 @@ static void djvu_page_text_content_append(djvu_page_text_t* page_text, miniexp_t
     miniexp_t data = miniexp_car(inner);
 
     if (miniexp_stringp(data) != 0) {
-      /* create position */
-      if (page_text->text_positions != NULL) {
-        text_position_t* position = malloc(sizeof(text_position_t));
-        if (position == NULL) {
-          inner = miniexp_cdr(inner);
-          continue;
-        }
-
-        position->position = (page_text->content != NULL) ? strlen(page_text->content) : 0;
-        position->exp      = exp;
+      /* tokens are separated by a space that belongs to the following token */
+      const bool first = page_text->text_positions->len == 0;
 
-        girara_list_append(page_text->text_positions, position);
-      }
+      /* create position */
+      text_position_t position = {
+          .position = content->len,
+          .exp      = exp,
+      };
+      g_array_append_val(page_text->text_positions, position);
 
       /* append text */
-      char* text = (char*)miniexp_to_str(data);
-
-      if (page_text->content == NULL) {
-        page_text->content = g_strdup(text);
-      } else {
-        char* tmp = g_strjoin(" ", page_text->content, text, NULL);
-        g_free(page_text->content);
-        page_text->content = tmp;
+      if (first == false) {
+        g_string_append_c(content, ' ');
       }
+      g_string_append(content, miniexp_to_str(data));
       /* not a string, recursive call */
     } else {
-      djvu_page_text_content_append(page_text, data);
+      djvu_page_text_content_append(page_text, content, data);
     }
 
     /* move to next object */
@@ -248,130 +359,200 @@ static void djvu_page_text_content_append(djvu_page_text_t* page_text, miniexp_t
   }
 }
 
-static miniexp_t text_position_get_exp(djvu_page_text_t* page_text, unsigned int index) {
-  if (page_text == NULL || page_text->text_positions == NULL) {
-    goto error_ret;
+static int text_position_get_index(djvu_page_text_t* page_text, unsigned int index) {
+  if (page_text == NULL || page_text->text_positions == NULL || page_text->text_positions->len == 0) {
+    return -1;
   }
 
-  int l = 0;
-  int m = 0;
-  int h = girara_list_size(page_text->text_positions) - 1;
+  /* find the last token that starts at or before index */
+  unsigned int l = 0;
+  unsigned int h = page_text->text_positions->len;
 
-  if (h < 0) {
-    goto error_ret;
+  while (h - l > 1) {
+    const unsigned int m = l + (h - l) / 2;
+
+    if (g_array_index(page_text->text_positions, text_position_t, m).position <= index) {
+      l = m;
+    } else {
+      h = m;
+    }
   }
 
-  while (l <= h) {
-    m = (l + h) >> 1;
+  return l;
+}
 
-    text_position_t* text_position = girara_list_nth(page_text->text_positions, m);
-    if (text_position == NULL) {
-      goto error_ret;
+static void djvu_page_text_build_rectangle(djvu_page_text_t* page_text, unsigned int start, unsigned int end,
+                                           unsigned int begin_byte, unsigned int end_byte) {
+  /* tokens are stored in text order, so a match covers a contiguous range */
+  for (unsigned int i = start; i <= end && i < page_text->text_positions->len; i++) {
+    const text_position_t* position = &g_array_index(page_text->text_positions, text_position_t, i);
+
+    /* bytes of the token without the space that separates it from the previous one */
+    const unsigned int token_begin = position->position + (i > 0 ? 1 : 0);
+    const unsigned int token_end   = (i + 1 < page_text->text_positions->len)
+                                         ? g_array_index(page_text->text_positions, text_position_t, i + 1).position
+                                         : strlen(page_text->content);
+
+    const unsigned int begin = MAX(begin_byte, token_begin);
+    const unsigned int last  = MIN(end_byte + 1, token_end);
+    if (begin >= last) {
+      continue;
     }
 
-    if (text_position->position == index) {
-      break;
-    } else if (text_position->position > index) {
-      h = --m;
-    } else {
-      l = m + 1;
+    zathura_rectangle_t rectangle;
+    if ((begin == token_begin && last == token_end) ||
+        djvu_page_text_refine(page_text, i, begin - token_begin, last - token_begin, &rectangle) == false) {
+      rectangle.x1 = miniexp_to_int(miniexp_nth(1, position->exp));
+      rectangle.y1 = miniexp_to_int(miniexp_nth(2, position->exp));
+      rectangle.x2 = miniexp_to_int(miniexp_nth(3, position->exp));
+      rectangle.y2 = miniexp_to_int(miniexp_nth(4, position->exp));
     }
-  }
 
-  text_position_t* text_position = girara_list_nth(page_text->text_positions, m);
-  if (text_position == NULL) {
-    goto error_ret;
-  } else {
-    return text_position->exp;
-  }
+    if (page_text->rectangle == NULL) {
+      page_text->rectangle = malloc(sizeof(zathura_rectangle_t));
+      if (page_text->rectangle == NULL) {
+        return;
+      }
 
-error_ret:
+      *page_text->rectangle = rectangle;
+      continue;
+    }
 
-  return miniexp_nil;
-}
+    if (rectangle.x1 < page_text->rectangle->x1) {
+      page_text->rectangle->x1 = rectangle.x1;
+    }
 
-static bool djvu_page_text_build_rectangle_process(djvu_page_text_t* page_text, miniexp_t exp, miniexp_t start,
-                                                   miniexp_t end) {
-  if (page_text == NULL) {
-    goto error_ret;
-  }
+    if (rectangle.x2 > page_text->rectangle->x2) {
+      page_text->rectangle->x2 = rectangle.x2;
+    }
 
-  if (page_text->rectangle != NULL || exp == start) {
-    zathura_rectangle_t* rectangle = calloc(1, sizeof(zathura_rectangle_t));
-    if (rectangle == NULL) {
-      goto error_ret;
+    if (rectangle.y1 < page_text->rectangle->y1) {
+      page_text->rectangle->y1 = rectangle.y1;
     }
 
-    rectangle->x1 = miniexp_to_int(miniexp_nth(1, exp));
-    rectangle->y1 = miniexp_to_int(miniexp_nth(2, exp));
-    rectangle->x2 = miniexp_to_int(miniexp_nth(3, exp));
-    rectangle->y2 = miniexp_to_int(miniexp_nth(4, exp));
+    if (rectangle.y2 > page_text->rectangle->y2) {
+      page_text->rectangle->y2 = rectangle.y2;
+    }
+  }
+}
 
-    if (page_text->rectangle != NULL) {
-      if (rectangle->x1 < page_text->rectangle->x1) {
-        page_text->rectangle->x1 = rectangle->x1;
-      }
+static bool djvu_page_text_refine(djvu_page_text_t* page_text, unsigned int token, unsigned int begin,
+                                  unsigned int end, zathura_rectangle_t* rectangle) {
+  GArray* characters = djvu_page_text_get_characters(page_text, token);
+  if (characters == NULL) {
+    return false;
+  }
 
-      if (rectangle->x2 > page_text->rectangle->x2) {
-        page_text->rectangle->x2 = rectangle->x2;
-      }
+  unsigned int offset = 0;
+  bool found          = false;
 
-      if (rectangle->y1 < page_text->rectangle->y1) {
-        page_text->rectangle->y1 = rectangle->y1;
+  for (guint i = 0; i < characters->len; i++) {
+    const text_character_t* character = &g_array_index(characters, text_character_t, i);
+    if (offset < end && offset + character->length > begin) {
+      if (found == false) {
+        *rectangle = character->rectangle;
+        found      = true;
+      } else {
+        rectangle->x1 = MIN(rectangle->x1, character->rectangle.x1);
+        rectangle->y1 = MIN(rectangle->y1, character->rectangle.y1);
+        rectangle->x2 = MAX(rectangle->x2, character->rectangle.x2);
+        rectangle->y2 = MAX(rectangle->y2, character->rectangle.y2);
       }
+    }
 
-      if (rectangle->y2 > page_text->rectangle->y2) {
-        page_text->rectangle->y2 = rectangle->y2;
-      }
+    offset += character->length;
+  }
 
-      free(rectangle);
-    } else {
-      page_text->rectangle = rectangle;
+  return found;
+}
+
+static GArray* djvu_page_text_get_characters(djvu_page_text_t* page_text, unsigned int token) {
+  if (page_text->word_characters == NULL) {
+    page_text->word_characters =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref);
+  }
+
+  GArray* characters = g_hash_table_lookup(page_text->word_characters, GUINT_TO_POINTER(token));
+  if (characters != NULL) {
+    return characters;
+  }
+
+  /* the character level text is only held until the search is done */
+  if (page_text->words == NULL) {
+    if (page_text->document == NULL) {
+      return NULL;
     }
 
-    if (exp == end) {
-      return false;
+    while ((page_text->characters = ddjvu_document_get_pagetext(page_text->document->document, page_text->index,
+                                                                "char")) == miniexp_dummy) {
+      handle_messages(page_text->document, true);
     }
+
+    page_text->words = g_array_new(FALSE, FALSE, sizeof(miniexp_t));
+    djvu_page_text_collect_words(page_text, page_text->characters);
   }
 
-  return true;
+  /* words that cannot be refined keep an empty list */
+  characters = g_array_new(FALSE, FALSE, sizeof(text_character_t));
+  g_hash_table_insert(page_text->word_characters, GUINT_TO_POINTER(token), characters);
 
-error_ret:
+  /* both levels list the same words unless the text layer is inconsistent */
+  if (page_text->text_positions == NULL || page_text->words->len != page_text->text_positions->len) {
+    return characters;
+  }
+
+  miniexp_t word         = g_array_index(page_text->words, miniexp_t, token);
+  const miniexp_t symbol = miniexp_symbol("char");
+
+  for (miniexp_t inner = miniexp_cddr(miniexp_cdddr(word)); miniexp_consp(inner) != 0; inner = miniexp_cdr(inner)) {
+    miniexp_t exp = miniexp_car(inner);
+    if (miniexp_consp(exp) == 0 || miniexp_car(exp) != symbol || miniexp_stringp(miniexp_nth(5, exp)) == 0) {
+      g_array_set_size(characters, 0);
+      break;
+    }
+
+    text_character_t character = {.length = strlen(miniexp_to_str(miniexp_nth(5, exp)))};
+    exp_to_box(exp, &character.rectangle);
+    g_array_append_val(characters, character);
+  }
 
-  return false;
+  return characters;
 }
 
-static bool djvu_page_text_build_rectangle(djvu_page_text_t* page_text, miniexp_t exp, miniexp_t start, miniexp_t end) {
-  if (page_text == NULL) {
-    goto error_ret;
+static void djvu_page_text_release_characters(djvu_page_text_t* page_text) {
+  if (page_text->characters != miniexp_nil && page_text->document != NULL) {
+    ddjvu_miniexp_release(page_text->document->document, page_text->characters);
+  }
+  page_text->characters = miniexp_nil;
+
+  if (page_text->words != NULL) {
+    g_array_free(page_text->words, TRUE);
+    page_text->words = NULL;
   }
+}
 
+static void djvu_page_text_collect_words(djvu_page_text_t* page_text, miniexp_t exp) {
   if (miniexp_consp(exp) == 0 || miniexp_symbolp(miniexp_car(exp)) == 0) {
-    return false;
+    return;
   }
 
-  miniexp_t inner = miniexp_cddr(miniexp_cdddr(exp));
-  while (inner != miniexp_nil) {
-    miniexp_t data = miniexp_car(inner);
+  /* words and any coarser zones that hold text directly are the tokens of
+   * the word level text */
+  if (miniexp_car(exp) == miniexp_symbol("word")) {
+    g_array_append_val(page_text->words, exp);
+    return;
+  }
 
-    if (miniexp_stringp(data) != 0) {
-      if (djvu_page_text_build_rectangle_process(page_text, exp, start, end) == false) {
-        goto error_ret;
-      }
-    } else {
-      if (djvu_page_text_build_rectangle(page_text, data, start, end) == false) {
-        goto error_ret;
-      }
+  for (miniexp_t inner = miniexp_cddr(miniexp_cdddr(exp)); miniexp_consp(inner) != 0; inner = miniexp_cdr(inner)) {
+    if (miniexp_stringp(miniexp_car(inner)) != 0) {
+      g_array_append_val(page_text->words, exp);
+      return;
     }
-
-    inner = miniexp_cdr(inner);
   }
 
-  return true;
-
-error_ret:
-
-  return false;
+  for (miniexp_t inner = miniexp_cddr(miniexp_cdddr(exp)); miniexp_consp(inner) != 0; inner = miniexp_cdr(inner)) {
+    djvu_page_text_collect_words(page_text, miniexp_car(inner));
+  }
 }
 
 char* djvu_page_text_select(djvu_page_text_t* page_text, zathura_rectangle_t rectangle) {
@@ -379,10 +560,18 @@ char* djvu_page_text_select(djvu_page_text_t* page_text, zathura_rectangle_t rec
     return NULL;
   }
 
+  page_text->begin = miniexp_nil;
+  page_text->end   = miniexp_nil;
+
   djvu_page_text_limit(page_text, page_text->text_information, &rectangle);
-  djvu_page_text_select_content(page_text, page_text->text_information, 0);
 
-  return (page_text->content != NULL) ? g_strdup(page_text->content) : NULL;
+  GString* content = NULL;
+  djvu_page_text_select_content(page_text, page_text->text_information, 0, &content);
+  if (content == NULL) {
+    return NULL;
+  }
+
+  return g_string_free(content, FALSE);
 }
 
 static void djvu_page_text_limit_process(djvu_page_text_t* page_text, miniexp_t exp, zathura_rectangle_t* rectangle) {
@@ -425,7 +614,8 @@ static void djvu_page_text_limit(djvu_page_text_t* page_text, miniexp_t exp, zat
   }
 }
 
-static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t exp, int delimiter) {
+static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t exp, int delimiter,
+                                          GString** content) {
   if (page_text == NULL) {
     return false;
   }
@@ -443,18 +633,21 @@ static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t
     miniexp_t data = miniexp_car(inner);
 
     if (miniexp_stringp(data) != 0) {
-      if (page_text->content != NULL || exp == page_text->begin) {
-        char* token_content = (char*)miniexp_to_str(miniexp_nth(5, exp));
-
-        if (page_text->content != NULL) {
-          char* content = g_strjoin((delimiter & 2)   ? "\n"
-                                    : (delimiter & 1) ? " "
-                                                      : NULL,
-                                    page_text->content, token_content, NULL);
-          g_free(page_text->content);
-          page_text->content = content;
+      if (*content != NULL || exp == page_text->begin) {
+        const char* token_content = miniexp_to_str(miniexp_nth(5, exp));
+        if (token_content == NULL) {
+          token_content = "";
+        }
+
+        if (*content != NULL) {
+          if ((delimiter & 2) != 0) {
+            g_string_append_c(*content, '\n');
+          } else if ((delimiter & 1) != 0) {
+            g_string_append_c(*content, ' ');
+          }
+          g_string_append(*content, token_content);
         } else {
-          page_text->content = g_strdup(token_content);
+          *content = g_string_new(token_content);
         }
 
         if (exp == page_text->end) {
@@ -462,7 +655,7 @@ static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t
         }
       }
     } else {
-      if (djvu_page_text_select_content(page_text, data, delimiter) == false) {
+      if (djvu_page_text_select_content(page_text, data, delimiter, content) == false) {
         return false;
       }
     }
@@ -473,3 +666,106 @@ static bool djvu_page_text_select_content(djvu_page_text_t* page_text, miniexp_t
 
   return true;
 }
+
+girara_list_t* djvu_page_text_select_lines(djvu_page_text_t* page_text, zathura_rectangle_t rectangle) {
+  if (page_text == NULL) {
+    return NULL;
+  }
+
+  if (page_text->boxes == NULL) {
+    unsigned int line_count = 0;
+    page_text->boxes        = g_array_new(FALSE, FALSE, sizeof(text_box_t));
+    djvu_page_text_collect_boxes(page_text, page_text->text_information, -1, &line_count);
+  }
+
+  girara_list_t* lines = girara_list_new_with_free(g_free);
+  if (lines == NULL) {
+    return NULL;
+  }
+
+  /* like the selected text, the selection runs from the first to the last
+   * token under the rectangle in text order */
+  int first = -1;
+  int last  = -1;
+  for (guint i = 0; i < page_text->boxes->len; i++) {
+    if (rectangle_intersects(&g_array_index(page_text->boxes, text_box_t, i).rectangle, &rectangle) == true) {
+      if (first == -1) {
+        first = i;
+      }
+      last = i;
+    }
+  }
+
+  if (first == -1) {
+    return lines;
+  }
+
+  zathura_rectangle_t* line = NULL;
+  unsigned int line_index   = 0;
+  for (int i = first; i <= last; i++) {
+    const text_box_t* box = &g_array_index(page_text->boxes, text_box_t, i);
+
+    if (line == NULL || box->line != line_index) {
+      line       = g_malloc(sizeof(zathura_rectangle_t));
+      *line      = box->rectangle;
+      line_index = box->line;
+      girara_list_append(lines, line);
+      continue;
+    }
+
+    line->x1 = MIN(line->x1, box->rectangle.x1);
+    line->y1 = MIN(line->y1, box->rectangle.y1);
+    line->x2 = MAX(line->x2, box->rectangle.x2);
+    line->y2 = MAX(line->y2, box->rectangle.y2);
+  }
+
+  return lines;
+}
+
+static void djvu_page_text_collect_boxes(djvu_page_text_t* page_text, miniexp_t exp, int line,
+                                         unsigned int* line_count) {
+  if (miniexp_consp(exp) == 0 || miniexp_symbolp(miniexp_car(exp)) == 0) {
+    return;
+  }
+
+  if (miniexp_car(exp) == miniexp_symbol("line")) {
+    line = (*line_count)++;
+  }
+
+  miniexp_t inner = miniexp_cddr(miniexp_cdddr(exp));
+  while (inner != miniexp_nil) {
+    miniexp_t data = miniexp_car(inner);
+
+    if (miniexp_stringp(data) != 0) {
+      /* tokens outside of a line zone form a line on their own */
+      text_box_t box = {
+          .line = (line >= 0) ? (unsigned int)line : (*line_count)++,
+      };
+      exp_to_box(exp, &box.rectangle);
+      g_array_append_val(page_text->boxes, box);
+    } else {
+      djvu_page_text_collect_boxes(page_text, data, line, line_count);
+    }
+
+    inner = miniexp_cdr(inner);
+  }
+}
+
+static void exp_to_box(miniexp_t exp, zathura_rectangle_t* rectangle) {
+  rectangle->x1 = miniexp_to_int(miniexp_nth(1, exp));
+  rectangle->y1 = miniexp_to_int(miniexp_nth(2, exp));
+  rectangle->x2 = miniexp_to_int(miniexp_nth(3, exp));
+  rectangle->y2 = miniexp_to_int(miniexp_nth(4, exp));
+}
+
+static bool rectangle_intersects(const zathura_rectangle_t* a, const zathura_rectangle_t* b) {
+  return a->x2 >= b->x1 && a->y1 <= b->y2 && a->x1 <= b->x2 && a->y2 >= b->y1;
+}
+
+static size_t array_get_size(GArray* array) {
+  if (array == NULL) {
+    return 0;
+  }
+
+  return array->len * g_array_get_element_size(array);
+}
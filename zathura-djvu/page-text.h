@@ -14,26 +14,45 @@
  * DjVu page text
  */
 typedef struct djvu_page_text_s {
-  miniexp_t text_information; /**< Text by ddjvu_document_get_pagetext */
-  char* content;              /**< Actual content */
+  miniexp_t text_information;  /**< Text by ddjvu_document_get_pagetext at word granularity */
+  miniexp_t characters;        /**< Text at character granularity, only held during a search */
+  GArray* words;               /**< Word zones of the character level text in text order */
+  GHashTable* word_characters; /**< Character boxes of refined words by token */
+  char* content;               /**< Content of the page, built on first search */
+  char* search_query;          /**< Query of the last search */
+  GArray* search_matches;      /**< Byte offsets of all occurrences of the last query */
 
   miniexp_t begin;                /**< Begin index */
   miniexp_t end;                  /**< End index */
-  girara_list_t* text_positions;  /**< Position/Expression duple */
+  GArray* text_positions;         /**< Position/Expression duples in text order */
+  GArray* boxes;                  /**< Boxes of all tokens in text order, built on first use */
   zathura_rectangle_t* rectangle; /**< Rectangle */
 
   djvu_document_t* document; /**< Correspondening document */
-  zathura_page_t* page;      /**< Correspondening page */
+  unsigned int index;        /**< Index of the correspondening page */
+  djvu_geometry_t geometry;  /**< Geometry of the correspondening page */
+  size_t size;               /**< Estimated size of the fetched expressions */
 } djvu_page_text_t;
 
 /**
  * Creates a new djvu page object
  *
  * @param document The document
- * @param page_number The number of the page
+ * @param index The index of the page
  * @return The page object or NULL if an error occurred
  */
-djvu_page_text_t* djvu_page_text_new(djvu_document_t* document, zathura_page_t* page);
+djvu_page_text_t* djvu_page_text_new(djvu_document_t* document, unsigned int index);
+
+/**
+ * Creates a djvu page object for a text layer that is not fetched from a
+ * document
+ *
+ * @param text Text in the format of ddjvu_document_get_pagetext, which has
+ *   to outlive the page object
+ * @param page_info Size and resolution of the page
+ * @return The page object or NULL if an error occurred
+ */
+djvu_page_text_t* djvu_page_text_new_from_expression(miniexp_t text, const ddjvu_pageinfo_t* page_info);
 
 /**
  * Frees a djvu page object
@@ -43,7 +62,38 @@ djvu_page_text_t* djvu_page_text_new(djvu_document_t* document, zathura_page_t*
 void djvu_page_text_free(djvu_page_text_t* page_text);
 
 /**
- * Searches the page for a specific key word and returns a list of results
+ * Returns the text layer of a page. Text layers that have been used before
+ * are taken out of the text cache of the document, all others are fetched
+ * from libdjvu.
+ *
+ * @param document The document
+ * @param index The index of the page
+ * @return The page object (release with djvu_page_text_return) or NULL if
+ *   the page has no text layer or an error occurred
+ */
+djvu_page_text_t* djvu_page_text_take(djvu_document_t* document, unsigned int index);
+
+/**
+ * Puts the text layer of a page back into the text cache
+ *
+ * @param document The document
+ * @param page_text The page object
+ */
+void djvu_page_text_return(djvu_document_t* document, djvu_page_text_t* page_text);
+
+/**
+ * Estimates the memory held by a djvu page object
+ *
+ * @param page_text The page object
+ * @return Estimated size in bytes
+ */
+size_t djvu_page_text_get_size(djvu_page_text_t* page_text);
+
+/**
+ * Searches the page for a specific key word and returns a list of results.
+ * The occurrences of the last query are remembered. If the new query extends
+ * it, only those occurrences are checked again, and pages without one are
+ * skipped right away.
  *
  * @param page_text The djvu page text object
  * @param text The text to search
@@ -60,4 +110,17 @@ girara_list_t* djvu_page_text_search(djvu_page_text_t* page_text, const char* te
  */
 char* djvu_page_text_select(djvu_page_text_t* page_text, zathura_rectangle_t rectangle);
 
+/**
+ * Returns the lines of text under the given rectangle. Every line is covered
+ * by one rectangle that spans the selected tokens of the line. The token
+ * boxes are collected once per page, so repeated calls while dragging a
+ * selection do not walk the text layer again.
+ *
+ * @param page_text The djvu page text object
+ * @param rectangle The selected area in pixel coordinates
+ * @return List of zathura_rectangle_t in pixel coordinates or NULL if an
+ *   error occurred
+ */
+girara_list_t* djvu_page_text_select_lines(djvu_page_text_t* page_text, zathura_rectangle_t rectangle);
+
 #endif // DJVU_PAGE_H
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "prefetch.h"
+#include "cache.h"
+#include "stats.h"
+#include "trace.h"
+#include "internal.h"
+
+/**
+ * Pages that are worth decoding
+ */
+typedef struct prefetch_window_s {
+  unsigned int index;    /**< Index of the page about to be rendered */
+  unsigned int distance; /**< Number of neighbours on each side */
+} prefetch_window_t;
+
+/* forward declarations */
+static size_t page_size_estimate(djvu_document_t* djvu_document, int index, ddjvu_page_t* djvu_page);
+static void prefetch_page(djvu_document_t* djvu_document, int index);
+static bool page_is_stale(uint64_t key, void* value, void* data);
+
+ddjvu_page_t* djvu_prefetch_take(djvu_document_t* djvu_document, unsigned int index) {
+  if (djvu_document == NULL) {
+    return NULL;
+  }
+
+  ddjvu_page_t* djvu_page = djvu_cache_take(djvu_document->pages, index);
+  if (djvu_page != NULL) {
+    /* stopped or failed pages are not worth keeping */
+    if (ddjvu_page_decoding_error(djvu_page) == FALSE) {
+      djvu_stats_add(DJVU_STATS_PAGE_CACHE_HIT, 1);
+      return djvu_page;
+    }
+
+    djvu_prefetch_release(djvu_page);
+  }
+
+  djvu_stats_add(DJVU_STATS_PAGE_CACHE_MISS, 1);
+
+  djvu_page = ddjvu_page_create_by_pageno(djvu_document->document, index);
+  djvu_trace_page_requested(djvu_page, index);
+
+  return djvu_page;
+}
+
+void djvu_prefetch_return(djvu_document_t* djvu_document, unsigned int index, ddjvu_page_t* djvu_page) {
+  if (djvu_document == NULL || djvu_page == NULL) {
+    return;
+  }
+
+  djvu_cache_insert(djvu_document->pages, index, djvu_page, page_size_estimate(djvu_document, index, djvu_page));
+}
+
+void djvu_prefetch_release(ddjvu_page_t* djvu_page) {
+  if (djvu_page == NULL) {
+    return;
+  }
+
+  /* pages evicted or stopped while decoding never report it */
+  djvu_trace_page_released(djvu_page);
+  ddjvu_page_release(djvu_page);
+}
+
+void djvu_prefetch_schedule(djvu_document_t* djvu_document, unsigned int index) {
+  if (djvu_document == NULL || djvu_document->prefetch_distance == 0) {
+    return;
+  }
+
+  const int previous = g_atomic_int_get(&djvu_document->last_rendered_page);
+  g_atomic_int_set(&djvu_document->last_rendered_page, index);
+
+  /* reading backwards if the previously rendered page came after this one */
+  const int direction = (previous > (int)index) ? -1 : 1;
+  const int current   = index;
+
+  /* only prefetch what fits into the page cache next to the rendered page,
+   * so that prefetched pages do not evict each other while decoding */
+  size_t budget = djvu_cache_get_max_size(djvu_document->pages);
+  budget -= MIN(budget, page_size_estimate(djvu_document, current, NULL));
+
+  int count = 0;
+  for (; count < (int)djvu_document->prefetch_distance; count++) {
+    const size_t size = page_size_estimate(djvu_document, current + direction * (count + 1), NULL);
+    if (size > budget) {
+      break;
+    }
+    budget -= size;
+  }
+
+  /* the least important page is inserted first, so it is evicted first */
+  if (count == (int)djvu_document->prefetch_distance &&
+      page_size_estimate(djvu_document, current - direction, NULL) <= budget) {
+    prefetch_page(djvu_document, current - direction);
+  }
+
+  for (int i = count; i > 0; i--) {
+    prefetch_page(djvu_document, current + direction * i);
+  }
+}
+
+void djvu_prefetch_cancel_stale(djvu_document_t* djvu_document, unsigned int index) {
+  if (djvu_document == NULL) {
+    return;
+  }
+
+  /* one more page on each side, as neighbours are often visible too */
+  prefetch_window_t window = {
+      .index    = index,
+      .distance = djvu_document->prefetch_distance + 1,
+  };
+
+  djvu_cache_remove_if(djvu_document->pages, page_is_stale, &window);
+}
+
+static bool page_is_stale(uint64_t key, void* value, void* data) {
+  ddjvu_page_t* djvu_page         = value;
+  const prefetch_window_t* window = data;
+
+  /* decoded pages cost nothing to keep, neighbours are needed soon */
+  if (ddjvu_page_decoding_done(djvu_page) == TRUE) {
+    return false;
+  }
+
+  const uint64_t distance = (key > window->index) ? key - window->index : window->index - key;
+  if (distance <= window->distance) {
+    return false;
+  }
+
+  ddjvu_job_stop(ddjvu_page_job(djvu_page));
+
+  return true;
+}
+
+static void prefetch_page(djvu_document_t* djvu_document, int index) {
+  if (index < 0 || index >= ddjvu_document_get_pagenum(djvu_document->document)) {
+    return;
+  }
+
+  /* pages that are already cached are moved to the front again */
+  ddjvu_page_t* djvu_page = djvu_cache_take(djvu_document->pages, index);
+  if (djvu_page == NULL) {
+    /* decoding runs in the decoder threads of libdjvu */
+    djvu_page = ddjvu_page_create_by_pageno(djvu_document->document, index);
+    if (djvu_page == NULL) {
+      return;
+    }
+
+    djvu_trace_page_requested(djvu_page, index);
+  }
+
+  djvu_cache_insert(djvu_document->pages, index, djvu_page, page_size_estimate(djvu_document, index, djvu_page));
+}
+
+static size_t page_size_estimate(djvu_document_t* djvu_document, int index, ddjvu_page_t* djvu_page) {
+  if (index < 0 || index >= ddjvu_document_get_pagenum(djvu_document->document)) {
+    return 0;
+  }
+
+  ddjvu_pageinfo_t page_info;
+
+  /* only use the page info if it is already available */
+  if (ddjvu_document_get_pageinfo(djvu_document->document, index, &page_info) != DDJVU_JOB_OK) {
+    return ZATHURA_DJVU_PAGE_SIZE_ESTIMATE;
+  }
+
+  /* the type of a page is only known once it is decoded, pages of a
+   * document mostly share the type of their neighbours */
+  int page_type = g_atomic_int_get(&djvu_document->page_type);
+  if (djvu_page != NULL && ddjvu_page_decoding_done(djvu_page) == TRUE &&
+      ddjvu_page_decoding_error(djvu_page) == FALSE) {
+    page_type = ddjvu_page_get_type(djvu_page);
+    g_atomic_int_set(&djvu_document->page_type, page_type);
+  }
+
+  const size_t pixels = (size_t)page_info.width * page_info.height;
+
+  /* JB2 masks take about a bit per pixel, decoded IW44 layers roughly two bytes */
+  if (page_type == DDJVU_PAGETYPE_BITONAL) {
+    return pixels / 8;
+  }
+
+  return pixels * 2;
+}
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_PREFETCH_H
+#define DJVU_PREFETCH_H
+
+#include "djvu.h"
+
+/**
+ * Returns a decoding or decoded page. Pages that have been prefetched are
+ * taken out of the page cache, all other pages are created.
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @return The page (release with djvu_prefetch_return) or NULL if an error
+ *   occurred
+ */
+ddjvu_page_t* djvu_prefetch_take(djvu_document_t* document, unsigned int index);
+
+/**
+ * Puts a page back into the page cache after it has been rendered
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param page The page
+ */
+void djvu_prefetch_return(djvu_document_t* document, unsigned int index, ddjvu_page_t* page);
+
+/**
+ * Releases a page taken from or kept in the page cache, whether or not its
+ * decoding is done
+ *
+ * @param page The page
+ */
+void djvu_prefetch_release(ddjvu_page_t* page);
+
+/**
+ * Starts decoding the neighbours of a page that has just been rendered. The
+ * direction in which the document is read gets the configured prefetch
+ * distance, the opposite direction a single page. Pages are only prefetched
+ * as far as they fit into the page cache, and the next page in reading
+ * direction is the last to be evicted.
+ *
+ * @param document The document
+ * @param index Index of the rendered page
+ */
+void djvu_prefetch_schedule(djvu_document_t* document, unsigned int index);
+
+/**
+ * Stops prefetched pages that are still decoding but no longer close to the
+ * page about to be rendered, so that libdjvu decodes the visible page first.
+ *
+ * @param document The document
+ * @param index Index of the page about to be rendered
+ */
+void djvu_prefetch_cancel_stale(djvu_document_t* document, unsigned int index);
+
+#endif // DJVU_PREFETCH_H
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <string.h>
+#include <girara/macros.h>
+
+#include "render.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "trace.h"
+#include "internal.h"
+
+/* renders are keyed by page index and size, which leaves 20 bits per side */
+#define RENDER_SIZE_BITS 20
+#define RENDER_SIZE_MAX ((1 << RENDER_SIZE_BITS) - 1)
+
+/* a copy only pays off if the cache holds several renders of that size */
+#define RENDER_CACHE_MIN_ENTRIES 4
+
+/* forward declarations */
+static bool get_key(unsigned int index, cairo_surface_t* surface, uint64_t* key);
+static bool is_same_page(uint64_t key, void* value, void* data);
+static void copy_surface(cairo_surface_t* source, cairo_surface_t* target);
+
+zathura_error_t djvu_render_page(djvu_document_t* djvu_document, unsigned int index, cairo_surface_t* surface,
+                                 djvu_render_abort_t abort, void* data) {
+  if (djvu_document == NULL || surface == NULL || cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+    return ZATHURA_ERROR_INVALID_ARGUMENTS;
+  }
+
+  char* surface_data = (char*)cairo_image_surface_get_data(surface);
+  if (surface_data == NULL) {
+    return ZATHURA_ERROR_UNKNOWN;
+  }
+
+  ddjvu_page_t* djvu_page = djvu_prefetch_take(djvu_document, index);
+  if (djvu_page == NULL) {
+    return ZATHURA_ERROR_UNKNOWN;
+  }
+
+  gint64 start = djvu_stats_begin();
+  while (!ddjvu_page_decoding_done(djvu_page)) {
+    if (abort != NULL && abort(data) == true) {
+      ddjvu_job_stop(ddjvu_page_job(djvu_page));
+      djvu_prefetch_release(djvu_page);
+      return ZATHURA_ERROR_UNKNOWN;
+    }
+
+    handle_messages(djvu_document, true);
+  }
+  djvu_stats_end(DJVU_STATS_DECODE_WAIT, start);
+  djvu_trace_page_decoded(djvu_page);
+  djvu_trace_span("decode-wait", index, start);
+
+  const unsigned int width  = cairo_image_surface_get_width(surface);
+  const unsigned int height = cairo_image_surface_get_height(surface);
+
+  ddjvu_rect_t rrect = {0, 0, width, height};
+  ddjvu_rect_t prect = {0, 0, width, height};
+
+  /* render page */
+  start = djvu_stats_begin();
+  cairo_surface_flush(surface);
+  ddjvu_page_render(djvu_page, DDJVU_RENDER_COLOR, &prect, &rrect, djvu_document->format,
+                    cairo_image_surface_get_stride(surface), surface_data);
+  cairo_surface_mark_dirty(surface);
+  djvu_stats_end(DJVU_STATS_RENDER, start);
+  djvu_trace_span("render", index, start);
+  djvu_stats_add(DJVU_STATS_BYTES_RENDERED, (guint64)cairo_image_surface_get_stride(surface) * height);
+
+  djvu_prefetch_return(djvu_document, index, djvu_page);
+
+  return ZATHURA_ERROR_OK;
+}
+
+bool djvu_render_from_cache(djvu_document_t* djvu_document, unsigned int index, cairo_surface_t* surface) {
+  uint64_t key = 0;
+  if (djvu_document == NULL || get_key(index, surface, &key) == false) {
+    return false;
+  }
+
+  cairo_surface_t* render = djvu_cache_take(djvu_document->renders, key);
+  if (render != NULL && cairo_image_surface_get_format(render) != cairo_image_surface_get_format(surface)) {
+    cairo_surface_destroy(render);
+    render = NULL;
+  }
+
+  djvu_stats_add(render != NULL ? DJVU_STATS_RENDER_CACHE_HIT : DJVU_STATS_RENDER_CACHE_MISS, 1);
+  if (render == NULL) {
+    return false;
+  }
+
+  copy_surface(render, surface);
+
+  djvu_cache_insert(djvu_document->renders, key, render,
+                    (size_t)cairo_image_surface_get_stride(render) * cairo_image_surface_get_height(render));
+
+  return true;
+}
+
+void djvu_render_to_cache(djvu_document_t* djvu_document, unsigned int index, cairo_surface_t* surface) {
+  uint64_t key = 0;
+  if (djvu_document == NULL || get_key(index, surface, &key) == false) {
+    return;
+  }
+
+  const int width   = cairo_image_surface_get_width(surface);
+  const int height  = cairo_image_surface_get_height(surface);
+  const size_t size = (size_t)cairo_image_surface_get_stride(surface) * height;
+
+  /* renders that would evict most of the cache are not worth the copy */
+  if (size > djvu_cache_get_max_size(djvu_document->renders) / RENDER_CACHE_MIN_ENTRIES) {
+    return;
+  }
+
+  cairo_surface_t* render = cairo_image_surface_create(cairo_image_surface_get_format(surface), width, height);
+  if (cairo_surface_status(render) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(render);
+    return;
+  }
+
+  copy_surface(surface, render);
+
+  djvu_cache_insert(djvu_document->renders, key, render, size);
+}
+
+void djvu_render_forget(djvu_document_t* djvu_document, unsigned int index) {
+  if (djvu_document == NULL) {
+    return;
+  }
+
+  djvu_cache_remove_if(djvu_document->renders, is_same_page, &index);
+}
+
+static bool get_key(unsigned int index, cairo_surface_t* surface, uint64_t* key) {
+  if (surface == NULL || cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE) {
+    return false;
+  }
+
+  const int width  = cairo_image_surface_get_width(surface);
+  const int height = cairo_image_surface_get_height(surface);
+  if (width <= 0 || height <= 0 || width > RENDER_SIZE_MAX || height > RENDER_SIZE_MAX) {
+    return false;
+  }
+
+  *key = ((uint64_t)index << (2 * RENDER_SIZE_BITS)) | ((uint64_t)width << RENDER_SIZE_BITS) | (uint64_t)height;
+
+  return true;
+}
+
+static bool is_same_page(uint64_t key, void* UNUSED(value), void* data) {
+  const unsigned int* index = data;
+
+  return (key >> (2 * RENDER_SIZE_BITS)) == *index;
+}
+
+static void copy_surface(cairo_surface_t* source, cairo_surface_t* target) {
+  /* both surfaces have the same format and width and thus the same stride */
+  const size_t size = (size_t)cairo_image_surface_get_stride(source) * cairo_image_surface_get_height(source);
+
+  cairo_surface_flush(source);
+  cairo_surface_flush(target);
+  memcpy(cairo_image_surface_get_data(target), cairo_image_surface_get_data(source), size);
+  cairo_surface_mark_dirty(target);
+}
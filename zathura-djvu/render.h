@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_RENDER_H
+#define DJVU_RENDER_H
+
+#include <stdbool.h>
+#include <cairo.h>
+
+#include "djvu.h"
+
+/**
+ * Callback that abandons a render while its page is being decoded
+ *
+ * @param data Custom data
+ * @return true if the render is no longer needed
+ */
+typedef bool (*djvu_render_abort_t)(void* data);
+
+/**
+ * Decodes a page, or takes it from the prefetched pages, and renders it onto
+ * an image surface of the requested size
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param surface Image surface
+ * @param abort Callback that is polled while the page is decoded or NULL
+ * @param data Custom data passed to the callback
+ * @return ZATHURA_ERROR_OK if the page has been rendered, otherwise an error
+ *   value (see zathura_error_t)
+ */
+zathura_error_t djvu_render_page(djvu_document_t* document, unsigned int index, cairo_surface_t* surface,
+                                 djvu_render_abort_t abort, void* data);
+
+/**
+ * Copies an earlier render of a page onto an image surface. Renders are kept
+ * per page and size, so switching back to a zoom level or redrawing a page
+ * does not decode it again.
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param surface Image surface
+ * @return true if a render of the same size was cached, otherwise false
+ */
+bool djvu_render_from_cache(djvu_document_t* document, unsigned int index, cairo_surface_t* surface);
+
+/**
+ * Keeps a copy of a rendered page in the render cache of the document.
+ * Renders too large for the cache to hold several of them are not copied.
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param surface Image surface holding the render
+ */
+void djvu_render_to_cache(djvu_document_t* document, unsigned int index, cairo_surface_t* surface);
+
+/**
+ * Drops all cached renders of a page
+ *
+ * @param document The document
+ * @param index Index of the page
+ */
+void djvu_render_forget(djvu_document_t* document, unsigned int index);
+
+#endif // DJVU_RENDER_H
@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib-unix.h>
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+#include "stats.h"
+
+#define STATS_BUCKETS 32
+
+/* dumping on SIGUSR1 is requested with this prefix */
+#define STATS_SIGNAL_PREFIX "signal:"
+
+/**
+ * Timings of an operation
+ */
+typedef struct stats_probe_s {
+  guint64 count;                    /**< Number of calls */
+  guint64 total;                    /**< Accumulated duration in microseconds */
+  guint64 max;                      /**< Longest duration in microseconds */
+  guint64 histogram[STATS_BUCKETS]; /**< Bucket i counts durations below 2^i microseconds */
+} stats_probe_t;
+
+static const char* probe_names[DJVU_STATS_PROBE_COUNT] = {
+    "decode-wait", "render", "text-fetch", "search", "selection", "links", "outline",
+};
+
+static const char* counter_names[DJVU_STATS_COUNTER_COUNT] = {
+    "bytes-rendered", "page-cache-hits", "page-cache-misses", "thumbnail-cache-hits", "thumbnail-cache-misses",
+    "render-cache-hits", "render-cache-misses",
+};
+
+static GMutex stats_lock;
+static stats_probe_t probes[DJVU_STATS_PROBE_COUNT];
+static guint64 counters[DJVU_STATS_COUNTER_COUNT];
+
+/* forward declarations */
+static const char* stats_get_destination(bool* on_signal);
+static gboolean stats_signal(gpointer data);
+
+void djvu_stats_init(void) {
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    /* dispatched from the main loop, so dumping is not restricted to
+     * async-signal-safe functions */
+    bool on_signal = false;
+    if (stats_get_destination(&on_signal) != NULL && on_signal == true) {
+      g_unix_signal_add(SIGUSR1, stats_signal, NULL);
+    }
+
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+gint64 djvu_stats_begin(void) {
+  return g_get_monotonic_time();
+}
+
+void djvu_stats_end(djvu_stats_probe_t probe, gint64 start) {
+  if (probe >= DJVU_STATS_PROBE_COUNT) {
+    return;
+  }
+
+  const guint64 duration = MAX(g_get_monotonic_time() - start, 0);
+  const guint bucket     = MIN(g_bit_storage(duration), STATS_BUCKETS - 1);
+
+#ifdef HAVE_SYS_SDT_H
+  DTRACE_PROBE2(zathura_djvu, timing, (int)probe, duration);
+#endif
+
+  g_mutex_lock(&stats_lock);
+  probes[probe].count++;
+  probes[probe].total += duration;
+  probes[probe].max = MAX(probes[probe].max, duration);
+  probes[probe].histogram[bucket]++;
+  g_mutex_unlock(&stats_lock);
+}
+
+void djvu_stats_add(djvu_stats_counter_t counter, guint64 value) {
+  if (counter >= DJVU_STATS_COUNTER_COUNT) {
+    return;
+  }
+
+#ifdef HAVE_SYS_SDT_H
+  DTRACE_PROBE2(zathura_djvu, counter, (int)counter, value);
+#endif
+
+  g_mutex_lock(&stats_lock);
+  counters[counter] += value;
+  g_mutex_unlock(&stats_lock);
+}
+
+void djvu_stats_dump(void) {
+  const char* destination = stats_get_destination(NULL);
+  if (destination == NULL) {
+    return;
+  }
+
+  const bool to_stderr = g_strcmp0(destination, "stderr") == 0;
+  FILE* fp             = to_stderr == true ? stderr : fopen(destination, "a");
+  if (fp == NULL) {
+    return;
+  }
+
+  /* one record per line, fields separated by spaces */
+  g_mutex_lock(&stats_lock);
+  for (unsigned int i = 0; i < DJVU_STATS_PROBE_COUNT; i++) {
+    fprintf(fp, "probe=%s count=%" G_GUINT64_FORMAT " total_us=%" G_GUINT64_FORMAT " max_us=%" G_GUINT64_FORMAT
+                " histogram=",
+            probe_names[i], probes[i].count, probes[i].total, probes[i].max);
+    for (unsigned int j = 0; j < STATS_BUCKETS; j++) {
+      fprintf(fp, j == 0 ? "%" G_GUINT64_FORMAT : ",%" G_GUINT64_FORMAT, probes[i].histogram[j]);
+    }
+    fputc('\n', fp);
+  }
+
+  for (unsigned int i = 0; i < DJVU_STATS_COUNTER_COUNT; i++) {
+    fprintf(fp, "counter=%s value=%" G_GUINT64_FORMAT "\n", counter_names[i], counters[i]);
+  }
+  g_mutex_unlock(&stats_lock);
+
+  if (to_stderr == true) {
+    fflush(fp);
+  } else {
+    fclose(fp);
+  }
+}
+
+static const char* stats_get_destination(bool* on_signal) {
+  const char* destination = g_getenv("ZATHURA_DJVU_STATS");
+  if (destination == NULL) {
+    return NULL;
+  }
+
+  const bool prefixed = g_str_has_prefix(destination, STATS_SIGNAL_PREFIX);
+  if (prefixed == true) {
+    destination += strlen(STATS_SIGNAL_PREFIX);
+  }
+
+  if (on_signal != NULL) {
+    *on_signal = prefixed;
+  }
+
+  return destination[0] != '\0' ? destination : NULL;
+}
+
+static gboolean stats_signal(gpointer UNUSED(data)) {
+  djvu_stats_dump();
+
+  return G_SOURCE_CONTINUE;
+}
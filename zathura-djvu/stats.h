@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_STATS_H
+#define DJVU_STATS_H
+
+#include <glib.h>
+#include <girara/macros.h>
+
+/**
+ * Timed operations
+ */
+typedef enum djvu_stats_probe_e {
+  DJVU_STATS_DECODE_WAIT, /**< Waiting for a page to be decoded */
+  DJVU_STATS_RENDER,      /**< Rendering a page */
+  DJVU_STATS_TEXT_FETCH,  /**< Fetching the text layer of a page */
+  DJVU_STATS_SEARCH,      /**< Searching a page */
+  DJVU_STATS_SELECTION,   /**< Extracting selected text */
+  DJVU_STATS_LINKS,       /**< Parsing the links of a page */
+  DJVU_STATS_OUTLINE,     /**< Building the outline */
+  DJVU_STATS_PROBE_COUNT,
+} djvu_stats_probe_t;
+
+/**
+ * Counted events
+ */
+typedef enum djvu_stats_counter_e {
+  DJVU_STATS_BYTES_RENDERED,       /**< Bytes of rendered image data */
+  DJVU_STATS_PAGE_CACHE_HIT,       /**< Pages taken from the page cache */
+  DJVU_STATS_PAGE_CACHE_MISS,      /**< Pages that had to be created */
+  DJVU_STATS_THUMBNAIL_CACHE_HIT,  /**< Thumbnails taken from the cache */
+  DJVU_STATS_THUMBNAIL_CACHE_MISS, /**< Thumbnails that had to be created */
+  DJVU_STATS_RENDER_CACHE_HIT,     /**< Renders copied from the render cache */
+  DJVU_STATS_RENDER_CACHE_MISS,    /**< Renders that had to be decoded */
+  DJVU_STATS_COUNTER_COUNT,
+} djvu_stats_counter_t;
+
+#ifdef DJVU_INSTRUMENTATION
+
+/**
+ * Installs the SIGUSR1 handler that dumps the statistics if ZATHURA_DJVU_STATS
+ * starts with "signal:". The handler is dispatched by the default main loop.
+ * Only the first call has an effect.
+ */
+void djvu_stats_init(void);
+
+/**
+ * Starts timing an operation
+ *
+ * @return Start time to be passed to djvu_stats_end
+ */
+gint64 djvu_stats_begin(void);
+
+/**
+ * Finishes timing an operation and records its duration
+ *
+ * @param probe The operation
+ * @param start Start time returned by djvu_stats_begin
+ */
+void djvu_stats_end(djvu_stats_probe_t probe, gint64 start);
+
+/**
+ * Increases a counter
+ *
+ * @param counter The counter
+ * @param value Amount to add
+ */
+void djvu_stats_add(djvu_stats_counter_t counter, guint64 value);
+
+/**
+ * Writes the statistics to the destination set by ZATHURA_DJVU_STATS, either
+ * "stderr" or the path of a file the statistics are appended to, optionally
+ * preceded by "signal:". Nothing is written if the variable is not set.
+ */
+void djvu_stats_dump(void);
+
+#else
+
+static inline void djvu_stats_init(void) {}
+
+static inline gint64 djvu_stats_begin(void) {
+  return 0;
+}
+
+static inline void djvu_stats_end(djvu_stats_probe_t UNUSED(probe), gint64 UNUSED(start)) {}
+
+static inline void djvu_stats_add(djvu_stats_counter_t UNUSED(counter), guint64 UNUSED(value)) {}
+
+static inline void djvu_stats_dump(void) {}
+
+#endif // DJVU_INSTRUMENTATION
+
+#endif // DJVU_STATS_H
@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <girara/log.h>
+
+#include "stream.h"
+#include "config.h"
+#include "internal.h"
+
+/* magic, chunk name and chunk length of a DjVu file */
+#define STREAM_HEADER_SIZE 12
+
+/**
+ * Stream request answered by a reader thread
+ */
+typedef struct stream_request_s {
+  djvu_document_t* document; /**< Document */
+  int streamid;              /**< Stream */
+  char* path;                /**< Path of the file to read */
+} stream_request_t;
+
+/* forward declarations */
+static bool stream_write_file(djvu_document_t* djvu_document, int streamid, const char* path);
+static size_t stream_get_declared_length(const guint8* header);
+static void stream_reader(gpointer data, gpointer user_data);
+
+ddjvu_document_t* djvu_stream_create_document(djvu_document_t* djvu_document, const char* path) {
+  if (djvu_document == NULL || path == NULL) {
+    return NULL;
+  }
+
+  if (djvu_config_get_bool("ZATHURA_DJVU_STREAMING", false) == true) {
+    djvu_document->stream_mode = DJVU_STREAM_MODE_STREAMING;
+    djvu_document->stream_readers =
+        g_thread_pool_new(stream_reader, NULL, ZATHURA_DJVU_STREAM_READERS, FALSE, NULL);
+    if (djvu_document->stream_readers == NULL) {
+      return NULL;
+    }
+  } else {
+    djvu_document->stream_mode = DJVU_STREAM_MODE_FILENAME;
+    return ddjvu_document_create_by_filename(djvu_document->context, path, TRUE);
+  }
+
+  /* component files of indirect documents are resolved relative to the url */
+  char* absolute_path = g_canonicalize_filename(path, NULL);
+  char* url           = g_filename_to_uri(absolute_path, NULL, NULL);
+  g_free(absolute_path);
+  if (url == NULL) {
+    return NULL;
+  }
+
+  ddjvu_document_t* document = ddjvu_document_create(djvu_document->context, url, TRUE);
+  g_free(url);
+
+  return document;
+}
+
+void djvu_stream_close(djvu_document_t* djvu_document) {
+  if (djvu_document == NULL || djvu_document->stream_readers == NULL) {
+    return;
+  }
+
+  /* waits for all readers, which stop at their next chunk */
+  g_atomic_int_set(&djvu_document->streams_cancelled, TRUE);
+  g_thread_pool_free(djvu_document->stream_readers, FALSE, TRUE);
+  djvu_document->stream_readers = NULL;
+}
+
+void djvu_stream_handle_message(djvu_document_t* djvu_document, const ddjvu_message_t* message) {
+  if (djvu_document == NULL || message == NULL || message->m_any.tag != DDJVU_NEWSTREAM) {
+    return;
+  }
+
+  const int streamid = message->m_newstream.streamid;
+  char* path         = NULL;
+  if (message->m_newstream.url != NULL) {
+    path = g_filename_from_uri(message->m_newstream.url, NULL, NULL);
+  }
+
+  if (path != NULL && djvu_document->stream_mode == DJVU_STREAM_MODE_STREAMING) {
+    stream_request_t* request = g_malloc0(sizeof(stream_request_t));
+    request->document         = djvu_document;
+    request->streamid         = streamid;
+    request->path             = path;
+
+    if (g_thread_pool_push(djvu_document->stream_readers, request, NULL) == TRUE) {
+      return;
+    }
+
+    g_free(request);
+  }
+
+  girara_debug("djvu failed to load stream %d (%s)", streamid,
+               message->m_newstream.url != NULL ? message->m_newstream.url : "no url");
+  ddjvu_stream_close(djvu_document->document, streamid, TRUE);
+
+  g_free(path);
+}
+
+static bool stream_write_file(djvu_document_t* djvu_document, int streamid, const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  /* files that are still being written are followed until they reach the
+   * length declared in their header or stop growing */
+  const gint64 timeout = djvu_config_get_ulong("ZATHURA_DJVU_STREAM_TIMEOUT", ZATHURA_DJVU_STREAM_TIMEOUT) * 1000;
+  gint64 last_data     = g_get_monotonic_time();
+  bool result          = true;
+
+  guint8 header[STREAM_HEADER_SIZE];
+  size_t written  = 0;
+  size_t expected = SIZE_MAX;
+
+  char* buffer = g_malloc(ZATHURA_DJVU_STREAM_READ_SIZE);
+  while (true) {
+    if (g_atomic_int_get(&djvu_document->streams_cancelled) == TRUE) {
+      result = false;
+      break;
+    }
+
+    const size_t length = fread(buffer, 1, ZATHURA_DJVU_STREAM_READ_SIZE, fp);
+    if (length > 0) {
+      if (written < STREAM_HEADER_SIZE) {
+        const size_t header_length = MIN(length, STREAM_HEADER_SIZE - written);
+        memcpy(header + written, buffer, header_length);
+        if (written + header_length == STREAM_HEADER_SIZE) {
+          expected = stream_get_declared_length(header);
+        }
+      }
+
+      ddjvu_stream_write(djvu_document->document, streamid, buffer, length);
+      written += length;
+      last_data = g_get_monotonic_time();
+
+      if (written >= expected) {
+        break;
+      }
+      continue;
+    }
+
+    if (ferror(fp) != 0) {
+      result = false;
+      break;
+    }
+
+    /* files without a declared length are complete at their end */
+    if (written >= STREAM_HEADER_SIZE && expected == SIZE_MAX) {
+      break;
+    }
+
+    if (g_get_monotonic_time() - last_data >= timeout) {
+      break;
+    }
+
+    clearerr(fp);
+    g_usleep(ZATHURA_DJVU_STREAM_POLL_INTERVAL);
+  }
+
+  g_free(buffer);
+  fclose(fp);
+
+  return result;
+}
+
+static size_t stream_get_declared_length(const guint8* header) {
+  /* DjVu files are a single IFF FORM chunk behind the "AT&T" magic */
+  if (memcmp(header, "AT&TFORM", 8) != 0) {
+    return SIZE_MAX;
+  }
+
+  const size_t length = ((size_t)header[8] << 24) | ((size_t)header[9] << 16) | ((size_t)header[10] << 8) | header[11];
+
+  return STREAM_HEADER_SIZE + length;
+}
+
+static void stream_reader(gpointer data, gpointer UNUSED(user_data)) {
+  stream_request_t* request = data;
+
+  const bool result = stream_write_file(request->document, request->streamid, request->path);
+  if (result == false) {
+    girara_debug("djvu failed to stream %s", request->path);
+  }
+  ddjvu_stream_close(request->document->document, request->streamid, result == false);
+
+  g_free(request->path);
+  g_free(request);
+}
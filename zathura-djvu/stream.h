@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_STREAM_H
+#define DJVU_STREAM_H
+
+#include "djvu.h"
+
+/**
+ * Creates the ddjvu document of a file. Depending on the configured loading
+ * mode, libdjvu either reads the file itself or its data is supplied through
+ * ddjvu_stream_write when libdjvu requests it.
+ *
+ * @param document The document
+ * @param path Path to the file
+ * @return The ddjvu document or NULL if an error occurred
+ */
+ddjvu_document_t* djvu_stream_create_document(djvu_document_t* document, const char* path);
+
+/**
+ * Stops all pending stream readers of a document. Has to be called before
+ * the ddjvu document is released.
+ *
+ * @param document The document
+ */
+void djvu_stream_close(djvu_document_t* document);
+
+/**
+ * Answers a DDJVU_NEWSTREAM message. In streaming mode the data is written
+ * asynchronously by a reader thread.
+ *
+ * @param document The document
+ * @param message The message
+ */
+void djvu_stream_handle_message(djvu_document_t* document, const ddjvu_message_t* message);
+
+#endif // DJVU_STREAM_H
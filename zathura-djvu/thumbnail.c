@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <glib.h>
+
+#include "thumbnail.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "internal.h"
+
+/* forward declarations */
+static cairo_surface_t* thumbnail_from_document(djvu_document_t* djvu_document, unsigned int index);
+static cairo_surface_t* thumbnail_from_page(djvu_document_t* djvu_document, unsigned int index, int width,
+                                            int height);
+static cairo_surface_t* thumbnail_copy(cairo_surface_t* source, int width, int height);
+static cairo_surface_t* thumbnail_check_size(cairo_surface_t* thumbnail, int width, int height);
+
+bool djvu_thumbnail_render(djvu_document_t* djvu_document, unsigned int index, cairo_surface_t* surface) {
+  if (djvu_document == NULL || surface == NULL) {
+    return false;
+  }
+
+  const int surface_width  = cairo_image_surface_get_width(surface);
+  const int surface_height = cairo_image_surface_get_height(surface);
+
+  /* thumbnails are only ever scaled down, smaller ones are replaced */
+  cairo_surface_t* thumbnail =
+      thumbnail_check_size(djvu_cache_take(djvu_document->thumbnails, index), surface_width, surface_height);
+  djvu_stats_add(thumbnail != NULL ? DJVU_STATS_THUMBNAIL_CACHE_HIT : DJVU_STATS_THUMBNAIL_CACHE_MISS, 1);
+  if (thumbnail == NULL) {
+    thumbnail = thumbnail_check_size(thumbnail_from_document(djvu_document, index), surface_width, surface_height);
+  }
+  if (thumbnail == NULL) {
+    thumbnail = thumbnail_from_page(djvu_document, index, surface_width, surface_height);
+  }
+  if (thumbnail == NULL) {
+    return false;
+  }
+
+  const int width  = cairo_image_surface_get_width(thumbnail);
+  const int height = cairo_image_surface_get_height(thumbnail);
+
+  /* scale thumbnail to the requested size */
+  cairo_t* cairo = cairo_create(surface);
+  cairo_scale(cairo, (double)surface_width / width, (double)surface_height / height);
+  cairo_set_source_surface(cairo, thumbnail, 0, 0);
+  cairo_pattern_set_filter(cairo_get_source(cairo), CAIRO_FILTER_GOOD);
+  cairo_paint(cairo);
+  cairo_destroy(cairo);
+
+  djvu_cache_insert(djvu_document->thumbnails, index, thumbnail,
+                    (size_t)cairo_image_surface_get_stride(thumbnail) * height);
+
+  return true;
+}
+
+static cairo_surface_t* thumbnail_from_document(djvu_document_t* djvu_document, unsigned int index) {
+  /* only use thumbnails that are embedded in the document */
+  ddjvu_status_t status;
+  while ((status = ddjvu_thumbnail_status(djvu_document->document, index, FALSE)) == DDJVU_JOB_STARTED) {
+    handle_messages(djvu_document, true);
+  }
+
+  if (status != DDJVU_JOB_OK) {
+    return NULL;
+  }
+
+  cairo_surface_t* surface =
+      cairo_image_surface_create(CAIRO_FORMAT_RGB24, ZATHURA_DJVU_THUMBNAIL_SIZE, ZATHURA_DJVU_THUMBNAIL_SIZE);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+
+  /* the thumbnail is scaled to fit and the actual size is returned */
+  int width  = ZATHURA_DJVU_THUMBNAIL_SIZE;
+  int height = ZATHURA_DJVU_THUMBNAIL_SIZE;
+
+  cairo_surface_flush(surface);
+  if (ddjvu_thumbnail_render(djvu_document->document, index, &width, &height, djvu_document->format,
+                             cairo_image_surface_get_stride(surface),
+                             (char*)cairo_image_surface_get_data(surface)) == FALSE ||
+      width <= 0 || height <= 0) {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+  cairo_surface_mark_dirty(surface);
+
+  cairo_surface_t* thumbnail = thumbnail_copy(surface, width, height);
+  cairo_surface_destroy(surface);
+
+  return thumbnail;
+}
+
+static cairo_surface_t* thumbnail_from_page(djvu_document_t* djvu_document, unsigned int index, int width,
+                                            int height) {
+  /* a page decoded for its thumbnail is kept for when it is viewed */
+  ddjvu_page_t* djvu_page = djvu_prefetch_take(djvu_document, index);
+  if (djvu_page == NULL) {
+    return NULL;
+  }
+
+  while (!ddjvu_page_decoding_done(djvu_page)) {
+    handle_messages(djvu_document, true);
+  }
+
+  if (ddjvu_page_decoding_error(djvu_page)) {
+    djvu_prefetch_release(djvu_page);
+    return NULL;
+  }
+
+  /* an integral subsample lets libdjvu skip its generic rescaler, the largest
+   * one that still covers the requested size avoids scaling up */
+  const int page_width       = ddjvu_page_get_width(djvu_page);
+  const int page_height      = ddjvu_page_get_height(djvu_page);
+  const int subsample        = MAX(1, MIN(page_width / MAX(width, 1), page_height / MAX(height, 1)));
+  const int subsample_width  = MAX(1, (page_width + subsample - 1) / subsample);
+  const int subsample_height = MAX(1, (page_height + subsample - 1) / subsample);
+
+  cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, subsample_width, subsample_height);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    djvu_prefetch_return(djvu_document, index, djvu_page);
+    return NULL;
+  }
+
+  ddjvu_rect_t rect = {0, 0, subsample_width, subsample_height};
+
+  cairo_surface_flush(surface);
+  const int rendered = ddjvu_page_render(djvu_page, DDJVU_RENDER_COLOR, &rect, &rect, djvu_document->format,
+                                         cairo_image_surface_get_stride(surface),
+                                         (char*)cairo_image_surface_get_data(surface));
+  cairo_surface_mark_dirty(surface);
+
+  djvu_prefetch_return(djvu_document, index, djvu_page);
+
+  if (rendered == FALSE) {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+
+  return surface;
+}
+
+static cairo_surface_t* thumbnail_copy(cairo_surface_t* source, int width, int height) {
+  cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+
+  cairo_t* cairo = cairo_create(surface);
+  cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(cairo, source, 0, 0);
+  cairo_paint(cairo);
+  cairo_destroy(cairo);
+
+  return surface;
+}
+
+static cairo_surface_t* thumbnail_check_size(cairo_surface_t* thumbnail, int width, int height) {
+  if (thumbnail == NULL) {
+    return NULL;
+  }
+
+  /* thumbnails fit into a square, so one side may be a pixel short of the
+   * aspect ratio of the page */
+  if (cairo_image_surface_get_width(thumbnail) + 1 < width || cairo_image_surface_get_height(thumbnail) + 1 < height) {
+    cairo_surface_destroy(thumbnail);
+    return NULL;
+  }
+
+  return thumbnail;
+}
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_THUMBNAIL_H
+#define DJVU_THUMBNAIL_H
+
+#include <stdbool.h>
+#include <cairo.h>
+
+#include "djvu.h"
+
+/**
+ * Renders a thumbnail of a page onto an image surface. Thumbnails embedded
+ * in the document are preferred, otherwise the page is rendered at a coarse
+ * subsample. The result is kept in the thumbnail cache of the document.
+ * Cached and embedded thumbnails are only used if they are at least as large
+ * as the surface, so thumbnails are never scaled up.
+ *
+ * @param document The document
+ * @param index Index of the page
+ * @param surface Image surface of at most ZATHURA_DJVU_THUMBNAIL_SIZE pixels
+ *   in each direction
+ * @return true if the thumbnail was rendered, otherwise false
+ */
+bool djvu_thumbnail_render(djvu_document_t* document, unsigned int index, cairo_surface_t* surface);
+
+#endif // DJVU_THUMBNAIL_H
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: Zlib */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "trace.h"
+
+/* older events are dropped once the limit is reached */
+#define TRACE_MAX_EVENTS (1024 * 1024)
+
+/**
+ * Span on the timeline of a page
+ */
+typedef struct trace_event_s {
+  const char* name;   /**< Name of the span */
+  unsigned int index; /**< Index of the page */
+  gint64 start;       /**< Start time in microseconds */
+  gint64 duration;    /**< Duration in microseconds */
+} trace_event_t;
+
+/**
+ * Page job whose decoding has not finished yet
+ */
+typedef struct trace_job_s {
+  unsigned int index;   /**< Index of the page */
+  gint64 requested;     /**< Time the job was created */
+  gint64 first_message; /**< Time of the first message or 0 */
+} trace_job_t;
+
+static GMutex trace_lock;
+static bool trace_enabled     = false;
+static GArray* trace_events   = NULL;
+static GHashTable* trace_jobs = NULL;
+
+/* forward declarations */
+static void trace_add(const char* name, unsigned int index, gint64 start, gint64 end);
+static void trace_finish_job(ddjvu_page_t* page, const char* name, gint64 now);
+
+void djvu_trace_init(void) {
+  static gsize initialized = 0;
+
+  if (g_once_init_enter(&initialized)) {
+    /* the JSON array format is used since it may be left unterminated, so
+     * every write only has to append its events */
+    const char* path = g_getenv("ZATHURA_DJVU_TRACE");
+    FILE* fp         = path != NULL && path[0] != '\0' ? fopen(path, "w") : NULL;
+    if (fp != NULL) {
+      fputs("[\n", fp);
+      fclose(fp);
+
+      trace_events  = g_array_new(FALSE, FALSE, sizeof(trace_event_t));
+      trace_jobs    = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+      trace_enabled = true;
+    }
+
+    g_once_init_leave(&initialized, 1);
+  }
+}
+
+void djvu_trace_page_requested(ddjvu_page_t* page, unsigned int index) {
+  if (trace_enabled == false || page == NULL) {
+    return;
+  }
+
+  trace_job_t* job = g_new0(trace_job_t, 1);
+  job->index       = index;
+  job->requested   = g_get_monotonic_time();
+
+  g_mutex_lock(&trace_lock);
+  g_hash_table_replace(trace_jobs, page, job);
+  g_mutex_unlock(&trace_lock);
+}
+
+void djvu_trace_page_message(const ddjvu_message_t* message) {
+  if (trace_enabled == false || message == NULL || message->m_any.page == NULL) {
+    return;
+  }
+
+  ddjvu_page_t* page = message->m_any.page;
+  const gint64 now   = g_get_monotonic_time();
+
+  g_mutex_lock(&trace_lock);
+  trace_job_t* job = g_hash_table_lookup(trace_jobs, page);
+  if (job != NULL && job->first_message == 0) {
+    job->first_message = now;
+    trace_add("queued", job->index, job->requested, now);
+  }
+  g_mutex_unlock(&trace_lock);
+
+  if (ddjvu_page_decoding_done(page) == TRUE) {
+    trace_finish_job(page, "decoding", now);
+  }
+}
+
+void djvu_trace_page_decoded(ddjvu_page_t* page) {
+  if (trace_enabled == false || page == NULL) {
+    return;
+  }
+
+  trace_finish_job(page, "decoding", g_get_monotonic_time());
+}
+
+void djvu_trace_page_released(ddjvu_page_t* page) {
+  if (trace_enabled == false || page == NULL) {
+    return;
+  }
+
+  /* the message reporting the end of decoding may not have been seen yet */
+  trace_finish_job(page, ddjvu_page_decoding_done(page) == TRUE ? "decoding" : "cancelled", g_get_monotonic_time());
+}
+
+void djvu_trace_span(const char* name, unsigned int index, gint64 start) {
+  if (trace_enabled == false) {
+    return;
+  }
+
+  const gint64 now = g_get_monotonic_time();
+
+  g_mutex_lock(&trace_lock);
+  trace_add(name, index, start, now);
+  g_mutex_unlock(&trace_lock);
+}
+
+void djvu_trace_write(void) {
+  if (trace_enabled == false) {
+    return;
+  }
+
+  /* every page gets its own track */
+  const int pid = getpid();
+
+  g_mutex_lock(&trace_lock);
+  FILE* fp = trace_events->len > 0 ? fopen(g_getenv("ZATHURA_DJVU_TRACE"), "a") : NULL;
+  if (fp != NULL) {
+    for (guint i = 0; i < trace_events->len; i++) {
+      const trace_event_t* event = &g_array_index(trace_events, trace_event_t, i);
+      fprintf(fp,
+              "{\"name\":\"%s\",\"cat\":\"djvu\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT
+              ",\"pid\":%d,\"tid\":%u,\"args\":{\"page\":%u}},\n",
+              event->name, event->start, event->duration, pid, event->index, event->index + 1);
+    }
+    fclose(fp);
+
+    /* written events are not repeated by the next write */
+    g_array_set_size(trace_events, 0);
+  }
+  g_mutex_unlock(&trace_lock);
+}
+
+static void trace_add(const char* name, unsigned int index, gint64 start, gint64 end) {
+  if (trace_events->len >= TRACE_MAX_EVENTS) {
+    g_array_remove_range(trace_events, 0, TRACE_MAX_EVENTS / 2);
+  }
+
+  trace_event_t event = {
+      .name     = name,
+      .index    = index,
+      .start    = start,
+      .duration = MAX(end - start, 0),
+  };
+  g_array_append_val(trace_events, event);
+}
+
+static void trace_finish_job(ddjvu_page_t* page, const char* name, gint64 now) {
+  g_mutex_lock(&trace_lock);
+  trace_job_t* job = g_hash_table_lookup(trace_jobs, page);
+  if (job != NULL) {
+    /* pages decoded before their first message was seen were never queued */
+    trace_add(name, job->index, job->first_message != 0 ? job->first_message : job->requested, now);
+    g_hash_table_remove(trace_jobs, page);
+  }
+  g_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: Zlib */
+
+#ifndef DJVU_TRACE_H
+#define DJVU_TRACE_H
+
+#include <glib.h>
+#include <girara/macros.h>
+#include <libdjvu/ddjvuapi.h>
+
+#ifdef DJVU_INSTRUMENTATION
+
+/**
+ * Enables tracing if ZATHURA_DJVU_TRACE is set and starts the trace file.
+ * Only the first call has an effect.
+ */
+void djvu_trace_init(void);
+
+/**
+ * Starts the timeline of a page job
+ *
+ * @param page The page job
+ * @param index Index of the page
+ */
+void djvu_trace_page_requested(ddjvu_page_t* page, unsigned int index);
+
+/**
+ * Records the first message of a page job and the end of its decoding
+ *
+ * @param message The message
+ */
+void djvu_trace_page_message(const ddjvu_message_t* message);
+
+/**
+ * Ends the timeline of a page job once its decoding is done. Calling this
+ * more than once has no effect.
+ *
+ * @param page The page job
+ */
+void djvu_trace_page_decoded(ddjvu_page_t* page);
+
+/**
+ * Ends the timeline of a page job that is released before its decoding is
+ * done with a cancelled span. Calling this for decoded pages has no effect.
+ *
+ * @param page The page job
+ */
+void djvu_trace_page_released(ddjvu_page_t* page);
+
+/**
+ * Records a span on the timeline of a page that ends now
+ *
+ * @param name Name of the span
+ * @param index Index of the page
+ * @param start Start time as returned by g_get_monotonic_time
+ */
+void djvu_trace_span(const char* name, unsigned int index, gint64 start);
+
+/**
+ * Appends the events recorded since the last call in the Chrome trace event
+ * format to the file set by ZATHURA_DJVU_TRACE
+ */
+void djvu_trace_write(void);
+
+#else
+
+static inline void djvu_trace_init(void) {}
+
+static inline void djvu_trace_page_requested(ddjvu_page_t* UNUSED(page), unsigned int UNUSED(index)) {}
+
+static inline void djvu_trace_page_message(const ddjvu_message_t* UNUSED(message)) {}
+
+static inline void djvu_trace_page_decoded(ddjvu_page_t* UNUSED(page)) {}
+
+static inline void djvu_trace_page_released(ddjvu_page_t* UNUSED(page)) {}
+
+static inline void djvu_trace_span(const char* UNUSED(name), unsigned int UNUSED(index), gint64 UNUSED(start)) {}
+
+static inline void djvu_trace_write(void) {}
+
+#endif // DJVU_INSTRUMENTATION
+
+#endif // DJVU_TRACE_H